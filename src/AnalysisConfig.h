@@ -0,0 +1,149 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxJSON.h"
+#include "ofxFft.h"
+
+// Settings of the audio analysis. Loaded from data/analysis.json when present:
+//
+//   {
+//     "fftSize": 4096,         power of two
+//     "overlap": 0.75,         or "hop": 1024 (samples between frames)
+//     "window": "hann",        rectangular, bartlett, hann, hamming, sine
+//     "bands": 1024,           values per frame, i.e. what the visuals read
+//     "minBin": 0,             linear mode: first FFT bin of the output
+//     "logBands": true,        log-frequency bands between minFrequency and maxFrequency
+//     "minFrequency": 30,
+//     "maxFrequency": 16000,
+//     "sampleRate": 44100,     8000 to 192000
+//     "audioBufferSize": 256,
+//     "onsetBands": 16,        equal bands of the values, each with its own onsets
+//     "onsetWindow": 0.5,      seconds of flux the adaptive threshold is the median of
+//     "onsetThreshold": 1.5,   onset when the flux is over median * onsetThreshold + onsetDelta
+//     "onsetDelta": 0.02,
+//     "onsetInterval": 0.1     seconds before a band can have its next onset
+//   }
+struct AnalysisConfig {
+    int fftSize = 16384;
+    int hopSize = 256;
+    fftWindowType window = OF_FFT_WINDOW_HAMMING;
+    int bandCount = 1024;
+    int minBin = 0;
+    bool logBands = false;
+    float minFrequency = 30;
+    float maxFrequency = 16000;
+    int sampleRate = 44100;
+    int audioBufferSize = 256;
+    int onsetBands = 16;
+    float onsetWindow = 0.5;
+    float onsetThreshold = 1.5;
+    float onsetDelta = 0.02;
+    float onsetInterval = 0.1;
+
+    bool load(string filename) {
+        ofxJSONElement json;
+        if (!ofFile::doesFileExist(filename) || !json.open(filename)) {
+            return false;
+        }
+        if (json.isMember("fftSize")) {
+            fftSize = json["fftSize"].asInt();
+        }
+        if (json.isMember("hop")) {
+            hopSize = json["hop"].asInt();
+        } else if (json.isMember("overlap")) {
+            hopSize = fftSize * (1.0 - json["overlap"].asFloat());
+        }
+        if (json.isMember("window")) {
+            window = windowFromName(json["window"].asString());
+        }
+        if (json.isMember("bands")) {
+            bandCount = json["bands"].asInt();
+        }
+        if (json.isMember("minBin")) {
+            minBin = json["minBin"].asInt();
+        }
+        if (json.isMember("logBands")) {
+            logBands = json["logBands"].asBool();
+        }
+        if (json.isMember("minFrequency")) {
+            minFrequency = json["minFrequency"].asFloat();
+        }
+        if (json.isMember("maxFrequency")) {
+            maxFrequency = json["maxFrequency"].asFloat();
+        }
+        if (json.isMember("sampleRate")) {
+            sampleRate = json["sampleRate"].asInt();
+        }
+        if (json.isMember("audioBufferSize")) {
+            audioBufferSize = json["audioBufferSize"].asInt();
+        }
+        if (json.isMember("onsetBands")) {
+            onsetBands = json["onsetBands"].asInt();
+        }
+        if (json.isMember("onsetWindow")) {
+            onsetWindow = json["onsetWindow"].asFloat();
+        }
+        if (json.isMember("onsetThreshold")) {
+            onsetThreshold = json["onsetThreshold"].asFloat();
+        }
+        if (json.isMember("onsetDelta")) {
+            onsetDelta = json["onsetDelta"].asFloat();
+        }
+        if (json.isMember("onsetInterval")) {
+            onsetInterval = json["onsetInterval"].asFloat();
+        }
+        validate();
+        return true;
+    }
+
+    void validate() {
+        int n = 64;
+        while (n < fftSize && n < 65536) {
+            n <<= 1;
+        }
+        fftSize = n;
+        hopSize = ofClamp(hopSize, 32, fftSize);
+        bandCount = MAX(1, bandCount);
+        minBin = ofClamp(minBin, 0, fftSize / 2);
+        sampleRate = ofClamp(sampleRate, 8000, 192000);
+        maxFrequency = ofClamp(maxFrequency, 1, sampleRate * 0.5);
+        minFrequency = ofClamp(minFrequency, 1, maxFrequency);
+        onsetBands = ofClamp(onsetBands, 1, bandCount);
+        onsetWindow = MAX(0.0f, onsetWindow);
+        onsetInterval = MAX(0.0f, onsetInterval);
+    }
+
+    // seconds of audio in one FFT window
+    float getLatency() const {
+        return static_cast<float>(fftSize) / sampleRate;
+    }
+
+    string toString() const {
+        stringstream ss;
+        ss << "fft " << fftSize << ", hop " << hopSize
+           << " (overlap " << (1.0 - static_cast<float>(hopSize) / fftSize) << ")"
+           << ", window " << windowName(window)
+           << ", " << bandCount << (logBands ? " log bands" : " bins from " + ofToString(minBin))
+           << ", " << onsetBands << " onset bands"
+           << ", latency " << static_cast<int>(getLatency() * 1000) << " ms";
+        return ss.str();
+    }
+
+    static fftWindowType windowFromName(string name) {
+        if (name == "rectangular") return OF_FFT_WINDOW_RECTANGULAR;
+        if (name == "bartlett") return OF_FFT_WINDOW_BARTLETT;
+        if (name == "hann") return OF_FFT_WINDOW_HANN;
+        if (name == "sine") return OF_FFT_WINDOW_SINE;
+        return OF_FFT_WINDOW_HAMMING;
+    }
+
+    static string windowName(fftWindowType window) {
+        switch (window) {
+            case OF_FFT_WINDOW_RECTANGULAR: return "rectangular";
+            case OF_FFT_WINDOW_BARTLETT: return "bartlett";
+            case OF_FFT_WINDOW_HANN: return "hann";
+            case OF_FFT_WINDOW_SINE: return "sine";
+            default: return "hamming";
+        }
+    }
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ofMain.h"
+
+// One published result of the audio analysis. Read-only once published.
+struct AnalysisFrame {
+    uint64_t sequence = 0;
+    double time = 0;            // seconds of audio analysed up to this frame
+
+    vector<float> bins;         // AnalysisConfig::bandCount values, normalized to 0..1, never NaN
+
+    // per AnalysisConfig::onsetBands band, see OnsetDetector
+    vector<uint32_t> onsetCount;    // onsets since the analysis started
+    vector<double> onsetTime;       // audio time of the latest one
+
+    float rms = 0;
+    float smoothedVolume = 0;
+    float scaledVolume = 0;     // smoothedVolume mapped to 0..1 by Util::getVolumeMax()
+};
@@ -0,0 +1,484 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxOsc.h"
+#include "AudioAnalyzer.h"
+#include "Recorder.h"
+#include "Clock.h"
+
+// Runs several mophV nodes off one analysis, over OSC on UDP:
+//
+//   mophV --lead host:port [host:port ...]
+//   mophV --follow [--port N] [--delay MS]
+//
+// The leader analyses its input as usual and sends every render frame to
+// each follower as one bundle: a /mophV/frame message with the frame number,
+// its clock and state, and the analysis frame when there is a new one, plus
+// /mophV/cue messages for the keys that change the visuals. Bins go as 16-bit
+// values, onsets as their running counts, so a lost bundle loses no onset.
+// A cue is repeated in the next CUE_REPEAT bundles and applied once.
+//
+// A follower has no audio input and runs no FFT. Frames wait in a jitter
+// buffer and play out delay milliseconds after the leader's clock, mapped to
+// the local one by the fastest arrival of the last few seconds. Each played
+// frame sets Clock and publishes its analysis frame, the way Replay does, so
+// all nodes draw the same frame from the same input. A frame that misses its
+// slot is dropped, and the log suggests a longer delay when that happens.
+// Followers pick up the leader's state when they join, but not the mode
+// inside it, so start them first.
+class AnalysisLink {
+public:
+    struct Settings {
+        enum Role {
+            Off,
+            Lead,
+            Follow
+        };
+
+        Role role = Off;
+        vector<string> targets;     // host:port per follower
+        int port = DEFAULT_PORT;
+        float delayMs = 50;
+
+        bool isEnabled() const {
+            return role != Off;
+        }
+
+        // argv[1] is --lead or --follow
+        bool parse(int argc, char* argv[]) {
+            role = (string(argv[1]) == "--lead" ? Lead : Follow);
+            for (int i = 2; i < argc; i++) {
+                string arg = argv[i];
+                if (role == Follow && arg == "--port" && i + 1 < argc) {
+                    port = ofToInt(argv[++i]);
+                } else if (role == Follow && arg == "--delay" && i + 1 < argc) {
+                    delayMs = ofToFloat(argv[++i]);
+                } else if (role == Lead && arg.compare(0, 2, "--") != 0) {
+                    targets.push_back(arg);
+                } else {
+                    cerr << "unknown argument " << arg << endl;
+                    return false;
+                }
+            }
+            if (role == Lead && targets.empty()) {
+                cerr << "usage: mophV --lead host:port [host:port ...]" << endl;
+                return false;
+            }
+            if (port <= 0 || port > 65535 || delayMs < 0) {
+                cerr << "usage: mophV --follow [--port N] [--delay MS]" << endl;
+                return false;
+            }
+            return true;
+        }
+    };
+
+    static const int DEFAULT_PORT = 9000;
+    static const int CUE_REPEAT = 8;
+    static const int BUFFER_FRAMES = 64;
+    // 16-bit bins keep a frame well inside one datagram
+    static const int MAX_VALUES = 16384;
+
+    void setSettings(const Settings& settings) {
+        _settings = settings;
+    }
+
+    bool isLeading() const {
+        return _settings.role == Settings::Lead;
+    }
+
+    bool isFollowing() const {
+        return _settings.role == Settings::Follow;
+    }
+
+    // Leader: opens a sender per target. Follower: listens, and starts the analyzer without a device.
+    void setup(AudioAnalyzer& analyzer, const AnalysisConfig& config) {
+        if (isLeading()) {
+            for (int i = 0; i < _settings.targets.size(); i++) {
+                vector<string> hostPort = ofSplitString(_settings.targets[i], ":");
+                int port = (hostPort.size() > 1 ? ofToInt(hostPort[1]) : DEFAULT_PORT);
+                shared_ptr<ofxOscSender> sender(new ofxOscSender());
+                sender->setup(hostPort[0], port);
+                _senders.push_back(sender);
+                ofLogNotice("AnalysisLink") << "leading " << hostPort[0] << ":" << port;
+            }
+            _quantized.reserve(MAX_VALUES);
+        } else if (isFollowing()) {
+            analyzer.setupOffline(config);
+            _analyzer = &analyzer;
+            _receiver.setup(_settings.port);
+            for (int i = 0; i < BUFFER_FRAMES; i++) {
+                _slots[i].analysis.bins.reserve(config.bandCount);
+            }
+            reset();
+            ofLogNotice("AnalysisLink") << "following on port " << _settings.port << ", " << _settings.delayMs << " ms behind";
+        }
+    }
+
+    // Leader, before the next send()
+    void addKey(int key) {
+        Cue cue;
+        cue.index = _cueTotal++;
+        cue.event.frame = _frame;
+        cue.event.type = Recorder::Key;
+        cue.event.value = key;
+        _cues.push_back(cue);
+    }
+
+    // Leader, once per update: this frame's clock and state, and the analysis frame the states get
+    void send(double clock, int state, const AnalysisFrame* analysis) {
+        ofxOscMessage frame;
+        frame.setAddress("/mophV/frame");
+        frame.addInt64Arg(_frame);
+        frame.addDoubleArg(clock);
+        frame.addIntArg(state);
+        if (analysis != NULL && analysis->sequence != _sentSequence) {
+            _sentSequence = analysis->sequence;
+            int n = MIN(analysis->bins.size(), static_cast<size_t>(MAX_VALUES));
+            _quantized.resize(n);
+            for (int i = 0; i < n; i++) {
+                _quantized[i] = ofClamp(analysis->bins[i], 0, 1) * 65535 + 0.5;
+            }
+            frame.addInt64Arg(analysis->sequence);
+            frame.addDoubleArg(analysis->time);
+            frame.addFloatArg(analysis->rms);
+            frame.addFloatArg(analysis->smoothedVolume);
+            frame.addFloatArg(analysis->scaledVolume);
+            frame.addBlobArg(ofBuffer(reinterpret_cast<const char*>(_quantized.data()), n * sizeof(uint16_t)));
+            frame.addBlobArg(ofBuffer(reinterpret_cast<const char*>(analysis->onsetCount.data()), analysis->onsetCount.size() * sizeof(uint32_t)));
+            frame.addBlobArg(ofBuffer(reinterpret_cast<const char*>(analysis->onsetTime.data()), analysis->onsetTime.size() * sizeof(double)));
+        }
+        ofxOscBundle bundle;
+        bundle.addMessage(frame);
+
+        while (!_cues.empty() && _cues.front().event.frame + CUE_REPEAT <= _frame) {
+            _cues.pop_front();
+        }
+        for (int i = 0; i < _cues.size(); i++) {
+            ofxOscMessage cue;
+            cue.setAddress("/mophV/cue");
+            cue.addInt64Arg(_cues[i].index);
+            cue.addInt64Arg(_cues[i].event.frame);
+            cue.addIntArg(_cues[i].event.value);
+            bundle.addMessage(cue);
+        }
+        for (int i = 0; i < _senders.size(); i++) {
+            _senders[i]->sendBundle(bundle);
+        }
+        _frame++;
+    }
+
+    // Follower, once per update. Plays the frames that are due and hands out their cues,
+    // false while none is due.
+    bool advance(vector<Recorder::Event>& events) {
+        events.clear();
+        double now = ofGetElapsedTimeMicros() / 1e6;
+        receive(now);
+        if (!_started) {
+            return false;
+        }
+        if (now - _lastArrival > SILENCE && !_silent) {
+            ofLogWarning("AnalysisLink") << "no frames from the leader for " << SILENCE << " s";
+            _silent = true;
+        }
+        report(now);
+
+        // the slots before _newest - BUFFER_FRAMES were overwritten
+        _next = MAX(_next, _newest + 1 - MIN(_newest + 1, static_cast<uint64_t>(BUFFER_FRAMES)));
+        double due = now - getOffset() - _settings.delayMs / 1000.0;
+        const Slot* played = NULL;
+        const Slot* analysis = NULL;
+        while (_next <= _newest) {
+            const Slot* slot = find(_next);
+            if (slot == NULL) {
+                // lost, unless a later frame can still wait for it
+                const Slot* later = NULL;
+                for (uint64_t n = _next + 1; n <= _newest && later == NULL; n++) {
+                    later = find(n);
+                }
+                if (later == NULL || later->clock > due) {
+                    break;
+                }
+                _lost++;
+                _next++;
+                continue;
+            }
+            if (slot->clock > due) {
+                break;
+            }
+            played = slot;
+            if (slot->hasAnalysis) {
+                analysis = slot;
+            }
+            _next++;
+        }
+        if (played == NULL) {
+            return false;
+        }
+        takeCues(played->number, events);
+        Clock::setFixed(played->clock);
+        _state = played->state;
+        if (analysis != NULL) {
+            publish(analysis->analysis);
+        }
+        return true;
+    }
+
+    // the leader's state in the last frame played, -1 before the first
+    int getLeaderState() const {
+        return _state;
+    }
+
+private:
+    struct Cue {
+        uint64_t index;
+        Recorder::Event event;
+    };
+
+    struct Slot {
+        bool valid = false;
+        uint64_t number = 0;
+        double clock = 0;
+        int state = 0;
+        bool hasAnalysis = false;
+        AnalysisFrame analysis;
+    };
+
+    enum {
+        OFFSET_SECONDS = 4,
+        SILENCE = 2,            // seconds without frames before the log says so
+        REPORT_INTERVAL = 10
+    };
+
+    void receive(double now) {
+        ofxOscMessage m;
+        while (_receiver.hasWaitingMessages()) {
+            _receiver.getNextMessage(m);
+            if (m.getAddress() == "/mophV/frame") {
+                readFrame(m, now);
+            } else if (m.getAddress() == "/mophV/cue") {
+                readCue(m);
+            }
+        }
+    }
+
+    void readFrame(const ofxOscMessage& m, double now) {
+        if (!hasArgs(m, "hdi")) {
+            return;
+        }
+        uint64_t number = m.getArgAsInt64(0);
+        if (_started && number + BUFFER_FRAMES < _next) {
+            ofLogNotice("AnalysisLink") << "the leader restarted";
+            reset();
+        }
+        if (_started && number < _next) {
+            _late++;
+            return;
+        }
+        Slot& slot = _slots[number % BUFFER_FRAMES];
+        slot.valid = false;
+        slot.number = number;
+        slot.clock = m.getArgAsDouble(1);
+        slot.state = m.getArgAsInt32(2);
+        slot.hasAnalysis = hasArgs(m, "hdihdfffbbb");
+        if (slot.hasAnalysis && !readAnalysis(m, slot.analysis)) {
+            return;
+        }
+        slot.valid = true;
+
+        if (!_started) {
+            _started = true;
+            _next = number;
+            _newest = number;
+        }
+        _newest = MAX(_newest, number);
+        if (_silent) {
+            ofLogNotice("AnalysisLink") << "frames from the leader again";
+            _silent = false;
+        }
+        _lastArrival = now;
+        addOffset(now, now - slot.clock);
+    }
+
+    bool readAnalysis(const ofxOscMessage& m, AnalysisFrame& frame) {
+        ofBuffer bins = m.getArgAsBlob(8);
+        ofBuffer counts = m.getArgAsBlob(9);
+        ofBuffer times = m.getArgAsBlob(10);
+        int nBins = bins.size() / sizeof(uint16_t);
+        int nOnsets = counts.size() / sizeof(uint32_t);
+        if (nBins == 0 || nBins > MAX_VALUES || nOnsets == 0 || nOnsets > nBins || times.size() != nOnsets * sizeof(double)) {
+            return false;
+        }
+        frame.sequence = m.getArgAsInt64(3);
+        frame.time = m.getArgAsDouble(4);
+        frame.rms = m.getArgAsFloat(5);
+        frame.smoothedVolume = m.getArgAsFloat(6);
+        frame.scaledVolume = m.getArgAsFloat(7);
+        frame.bins.resize(nBins);
+        const uint16_t* values = reinterpret_cast<const uint16_t*>(bins.getData());
+        for (int i = 0; i < nBins; i++) {
+            frame.bins[i] = values[i] / 65535.0f;
+        }
+        frame.onsetCount.resize(nOnsets);
+        memcpy(frame.onsetCount.data(), counts.getData(), counts.size());
+        frame.onsetTime.resize(nOnsets);
+        memcpy(frame.onsetTime.data(), times.getData(), times.size());
+        return true;
+    }
+
+    void readCue(const ofxOscMessage& m) {
+        if (!hasArgs(m, "hhi")) {
+            return;
+        }
+        Cue cue;
+        cue.index = m.getArgAsInt64(0);
+        cue.event.frame = m.getArgAsInt64(1);
+        cue.event.type = Recorder::Key;
+        cue.event.value = m.getArgAsInt32(2);
+        if (cue.index < _nextCue) {
+            return;
+        }
+        for (int i = 0; i < _pendingCues.size(); i++) {
+            if (_pendingCues[i].index == cue.index) {
+                return;
+            }
+        }
+        _pendingCues.push_back(cue);
+    }
+
+    // the cues up to and including frame, in the leader's order
+    void takeCues(uint64_t frame, vector<Recorder::Event>& events) {
+        sort(_pendingCues.begin(), _pendingCues.end(), [](const Cue& a, const Cue& b) { return a.index < b.index; });
+        int taken = 0;
+        while (taken < _pendingCues.size() && _pendingCues[taken].event.frame <= frame) {
+            const Cue& cue = _pendingCues[taken++];
+            if (cue.index > _nextCue) {
+                ofLogWarning("AnalysisLink") << "lost " << cue.index - _nextCue << " key(s) from the leader";
+            }
+            events.push_back(cue.event);
+            _nextCue = cue.index + 1;
+        }
+        _pendingCues.erase(_pendingCues.begin(), _pendingCues.begin() + taken);
+    }
+
+    // restarts the analyzer when the leader's frames have other sizes
+    void publish(const AnalysisFrame& frame) {
+        const AnalysisConfig& current = _analyzer->getConfig();
+        if (frame.bins.size() != current.bandCount || frame.onsetCount.size() != current.onsetBands) {
+            AnalysisConfig config = current;
+            config.bandCount = frame.bins.size();
+            config.onsetBands = frame.onsetCount.size();
+            _analyzer->setupOffline(config);
+        }
+        _analyzer->publish(frame);
+    }
+
+    const Slot* find(uint64_t number) const {
+        const Slot& slot = _slots[number % BUFFER_FRAMES];
+        return (slot.valid && slot.number == number ? &slot : NULL);
+    }
+
+    // local time minus leader clock, the lowest per second of the last OFFSET_SECONDS
+    void addOffset(double now, double offset) {
+        int64_t second = static_cast<int64_t>(now);
+        Bucket& b = _offsets[second % OFFSET_SECONDS];
+        if (b.second != second) {
+            b.second = second;
+            b.offset = offset;
+        } else {
+            b.offset = MIN(b.offset, offset);
+        }
+    }
+
+    double getOffset() const {
+        int64_t newest = 0;
+        for (int i = 0; i < OFFSET_SECONDS; i++) {
+            newest = MAX(newest, _offsets[i].second);
+        }
+        double offset = numeric_limits<double>::max();
+        for (int i = 0; i < OFFSET_SECONDS; i++) {
+            if (_offsets[i].second > newest - OFFSET_SECONDS) {
+                offset = MIN(offset, _offsets[i].offset);
+            }
+        }
+        return offset;
+    }
+
+    void report(double now) {
+        if (now - _lastReport < REPORT_INTERVAL) {
+            return;
+        }
+        if (_lost > 0 || _late > 0) {
+            ofLogWarning("AnalysisLink") << _lost << " frames lost and " << _late << " late in " << REPORT_INTERVAL
+                                         << " s, a longer --delay than " << _settings.delayMs << " ms may help";
+        }
+        _lost = 0;
+        _late = 0;
+        _lastReport = now;
+    }
+
+    void reset() {
+        for (int i = 0; i < BUFFER_FRAMES; i++) {
+            _slots[i].valid = false;
+        }
+        for (int i = 0; i < OFFSET_SECONDS; i++) {
+            _offsets[i] = Bucket();
+        }
+        _started = false;
+        _silent = false;
+        _next = 0;
+        _newest = 0;
+        _nextCue = 0;
+        _pendingCues.clear();
+        _state = -1;
+    }
+
+    // Whether the first arguments have these types: i int32, h int64, f float, d double, b blob
+    static bool hasArgs(const ofxOscMessage& m, const char* types) {
+        int n = strlen(types);
+        if (m.getNumArgs() < n) {
+            return false;
+        }
+        for (int i = 0; i < n; i++) {
+            ofxOscArgType type = m.getArgType(i);
+            bool ok = (types[i] == 'i' && type == OFXOSC_TYPE_INT32) || (types[i] == 'h' && type == OFXOSC_TYPE_INT64)
+                      || (types[i] == 'f' && type == OFXOSC_TYPE_FLOAT) || (types[i] == 'd' && type == OFXOSC_TYPE_DOUBLE)
+                      || (types[i] == 'b' && type == OFXOSC_TYPE_BLOB);
+            if (!ok) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct Bucket {
+        int64_t second = -1;
+        double offset = 0;
+    };
+
+    Settings _settings;
+
+    // leader
+    vector<shared_ptr<ofxOscSender> > _senders;
+    uint64_t _frame = 0;
+    uint64_t _sentSequence = 0;
+    uint64_t _cueTotal = 0;
+    deque<Cue> _cues;
+    vector<uint16_t> _quantized;
+
+    // follower
+    ofxOscReceiver _receiver;
+    AudioAnalyzer* _analyzer = NULL;
+    Slot _slots[BUFFER_FRAMES];
+    Bucket _offsets[OFFSET_SECONDS];
+    bool _started = false;
+    bool _silent = false;
+    uint64_t _next = 0;
+    uint64_t _newest = 0;
+    uint64_t _nextCue = 0;
+    vector<Cue> _pendingCues;
+    int _state = -1;
+    double _lastArrival = 0;
+    double _lastReport = 0;
+    int _lost = 0;
+    int _late = 0;
+};
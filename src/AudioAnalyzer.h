@@ -0,0 +1,328 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxFft.h"
+#include "Util.h"
+#include "SampleRing.h"
+#include "FrameRing.h"
+#include "AnalysisFrame.h"
+#include "AnalysisConfig.h"
+#include "PhaseTimer.h"
+#include "Recorder.h"
+#include "OnsetDetector.h"
+
+// Audio input and spectrum analysis off the render thread.
+//
+// The audio callback only mixes the input down to mono and pushes it into a
+// lock-free sample ring. A dedicated thread runs one FFT per hop over a rolling
+// window and publishes an AnalysisFrame into a FrameRing, where states read the
+// latest one in place with getFrame(). Onset detection runs on the same
+// thread, once per hop, so it sees every hop even when the states do not.
+//
+// Frames always carry AnalysisConfig::bandCount values, either a linear range
+// of FFT bins or log-frequency bands, so the FFT size can change per venue
+// without the visuals noticing.
+class AudioAnalyzer : public ofBaseSoundInput {
+public:
+    typedef FrameRing<AnalysisFrame, 8> Ring;
+    typedef Ring::Handle Frame;
+
+    ~AudioAnalyzer() {
+        close();
+    }
+
+    // Sent before every restart, on the thread restarting, with the new
+    // settings. States that read frames on other threads wait for them here.
+    ofEvent<AnalysisConfig> restartEvent;
+
+    // Opens the input, or when it is already open at the same rate and buffer
+    // size only restarts the analysis thread, and the audio keeps arriving in
+    // the sample ring meanwhile.
+    void setup(const AnalysisConfig& config) {
+        AnalysisConfig next = config;
+        next.validate();
+        ofNotifyEvent(restartEvent, next);
+        bool reopen = !_streaming
+            || next.sampleRate != _config.sampleRate
+            || next.audioBufferSize != _config.audioBufferSize
+            || _samples.capacity() < getSampleCapacity(next);
+        if (reopen) {
+            close();
+        } else {
+            stopAnalysis();
+        }
+        prepare(next, reopen);
+        _running = true;
+        _thread = thread(&AudioAnalyzer::run, this);
+
+        if (reopen) {
+            _stream.setup(0, 1, _sampleRate, _config.audioBufferSize, 2);
+            _stream.setInput(this);
+            _streaming = true;
+        }
+        ofLogNotice("AudioAnalyzer") << _config.toString();
+    }
+
+    // new settings, with the input if it has one
+    void restart(const AnalysisConfig& config) {
+        if (_streaming) {
+            setup(config);
+        } else {
+            setupOffline(config);
+        }
+    }
+
+    // No input device and no thread: process() analyzes on the caller's thread, for offline renders
+    void setupOffline(const AnalysisConfig& config) {
+        AnalysisConfig next = config;
+        next.validate();
+        ofNotifyEvent(restartEvent, next);
+        close();
+        prepare(config, true);
+        ofLogNotice("AudioAnalyzer") << "offline " << _config.toString();
+    }
+
+    // Offline only. Analyzes every hop the samples complete before returning, so
+    // the same input always gives the same frames.
+    void process(const float* samples, int n) {
+        for (int offset = 0; offset < n; offset += _hopSize) {
+            _samples.push(samples + offset, MIN(_hopSize, n - offset), 1);
+            while (_samples.pop(_hop.data(), _hopSize)) {
+                analyze(_hop.data(), _hopSize);
+            }
+        }
+    }
+
+    // Offline only. Publishes a frame analysed elsewhere, a recording's for
+    // instance, with the bands the states asked this analyzer for.
+    void publish(const AnalysisFrame& source) {
+        AnalysisFrame* frame = _frames.beginWrite();
+        if (frame == NULL) {
+            return;
+        }
+        shape(*frame);
+        frame->sequence = source.sequence;
+        frame->time = source.time;
+        frame->rms = source.rms;
+        frame->smoothedVolume = source.smoothedVolume;
+        frame->scaledVolume = source.scaledVolume;
+        int n = MIN(source.bins.size(), frame->bins.size());
+        copy(source.bins.begin(), source.bins.begin() + n, frame->bins.begin());
+        fill(frame->bins.begin() + n, frame->bins.end(), 0.0f);
+        if (source.onsetCount.size() == frame->onsetCount.size() && source.onsetTime.size() == frame->onsetTime.size()) {
+            frame->onsetCount = source.onsetCount;
+            frame->onsetTime = source.onsetTime;
+        }
+        _frames.publish();
+    }
+
+    // gets every hop the analysis thread consumes, from then on
+    void setRecorder(Recorder* recorder) {
+        _recorder = recorder;
+    }
+
+    const AnalysisConfig& getConfig() const {
+        return _config;
+    }
+
+    void close() {
+        _stream.close();
+        _streaming = false;
+        stopAnalysis();
+    }
+
+    // Latest published frame, pinned until the handle goes out of scope. Empty before the first one.
+    Frame getFrame() {
+        return _frames.acquire();
+    }
+
+    void audioReceived(float* input, int bufferSize, int nChannels) {
+        // nothing here may lock or allocate
+        _samples.push(input, bufferSize, nChannels);
+        _wake.notify_one();
+    }
+
+private:
+    void run() {
+        while (_running) {
+            if (_samples.pop(_hop.data(), _hopSize)) {
+                if (_recorder != NULL) {
+                    _recorder->addAudio(_hop.data(), _hopSize);
+                }
+                analyze(_hop.data(), _hopSize);
+            } else {
+                unique_lock<mutex> lock(_wakeMutex);
+                _wake.wait_for(lock, chrono::milliseconds(2));
+            }
+        }
+    }
+
+    void analyze(const float* samples, int n) {
+        PhaseTimer::Scope scope(PhaseTimer::Analysis);
+        // slide the window by one hop
+        memmove(_window.data(), _window.data() + n, sizeof(float) * (_fftSize - n));
+        memcpy(_window.data() + _fftSize - n, samples, sizeof(float) * n);
+
+        float* amplitude;
+        int binSize;
+        {
+            PhaseTimer::Scope fft("fft.update");
+            _fft->setSignal(_window.data());
+            amplitude = _fft->getAmplitude();
+            binSize = _fft->getBinSize();
+        }
+
+        float rms = Util::calcVolume(_window);
+        _smoothedVolume *= _smoothing;
+        _smoothedVolume += (1.0 - _smoothing) * rms;
+        _sequence++;
+
+        AnalysisFrame* frame = _frames.beginWrite();
+        if (frame == NULL) {
+            return;
+        }
+        shape(*frame);
+        frame->sequence = _sequence;
+        frame->time = static_cast<double>(_sequence) * _hopSize / _sampleRate;
+        frame->rms = rms;
+        frame->smoothedVolume = _smoothedVolume;
+        frame->scaledVolume = ofMap(_smoothedVolume, 0.0, Util::getVolumeMax(), 0.0, 1.0, true);
+
+        // normalized against the whole spectrum, like Util::normalize on getBins()
+        float maxValue;
+        {
+            PhaseTimer::Scope normalize("normalize");
+            float* bins = frame->bins.data();
+            maxValue = Kernels::maxAbs(amplitude, binSize);
+            float scale = (maxValue > 0 ? 1.0 / maxValue : 0);
+            if (_config.logBands) {
+                for (int i = 0; i < _binCount; i++) {
+                    bins[i] = logBand(amplitude, binSize, i);
+                }
+                Kernels::scale(bins, bins, _binCount, scale);
+            } else {
+                int n = ofClamp(binSize - _config.minBin, 0, _binCount);
+                Kernels::scale(amplitude + _config.minBin, bins, n, scale);
+                fill(bins + n, bins + _binCount, 0.0f);
+            }
+        }
+
+        {
+            PhaseTimer::Scope onsets("onsets");
+            _onsets.process(frame->bins.data(), maxValue, frame->time, *frame);
+        }
+
+        _frames.publish();
+    }
+
+    // joins the analysis thread, the input stream is left as it is
+    void stopAnalysis() {
+        if (_thread.joinable()) {
+            _running = false;
+            _wake.notify_one();
+            _thread.join();
+        }
+        if (_fft) {
+            delete _fft;
+            _fft = NULL;
+        }
+    }
+
+    static size_t getSampleCapacity(const AnalysisConfig& config) {
+        return MAX(config.sampleRate, config.fftSize * 2);
+    }
+
+    // With the analysis stopped. The sample ring is only reallocated with the
+    // input closed, the audio callback writes into it otherwise.
+    void prepare(const AnalysisConfig& config, bool allocateSamples) {
+        _config = config;
+        _config.validate();
+        _fftSize = _config.fftSize;
+        _hopSize = _config.hopSize;
+        _sampleRate = _config.sampleRate;
+        _binCount = _config.bandCount;
+        // SMOOTH_FACTOR was tuned per 60 fps render frame, keep its time constant per hop
+        _smoothing = pow(SMOOTH_FACTOR, 60.0 * _hopSize / _sampleRate);
+
+        _fft = ofxFft::create(_fftSize, _config.window, OF_FFT_BASIC);
+        _window.assign(_fftSize, 0);
+        _hop.assign(_hopSize, 0);
+        if (allocateSamples) {
+            _samples.allocate(getSampleCapacity(_config));
+        }
+        setupBandEdges();
+        _onsets.setup(_config);
+        // a state may still read a frame of the old sizes, its slot is resized once written again
+        _frames.reset();
+        for (int i = 0; i < _frames.size(); i++) {
+            if (!_frames.isPinned(i)) {
+                shape(_frames.at(i));
+            }
+        }
+        _sequence = 0;
+        _smoothedVolume = 0;
+    }
+
+    // Sizes a slot for the current settings, allocating only when they changed
+    void shape(AnalysisFrame& frame) const {
+        int nOnsetBands = _onsets.getNumBands();
+        if (frame.bins.size() != _binCount) {
+            frame.bins.assign(_binCount, 0);
+        }
+        if (frame.onsetCount.size() != nOnsetBands) {
+            frame.onsetCount.assign(nOnsetBands, 0);
+            frame.onsetTime.assign(nOnsetBands, 0);
+        }
+    }
+
+    // fractional FFT bin positions of log-spaced band edges
+    void setupBandEdges() {
+        _bandEdges.resize(_binCount + 1);
+        float ratio = _config.maxFrequency / _config.minFrequency;
+        for (int i = 0; i <= _binCount; i++) {
+            float frequency = _config.minFrequency * pow(ratio, static_cast<float>(i) / _binCount);
+            _bandEdges[i] = frequency * _fftSize / _sampleRate;
+        }
+    }
+
+    // peak of the bins inside a band, interpolated where a band is narrower than one bin
+    float logBand(const float* amplitude, int binSize, int band) const {
+        float lo = _bandEdges[band];
+        float hi = _bandEdges[band + 1];
+        if (hi - lo < 1) {
+            float center = MIN((lo + hi) * 0.5, binSize - 1.0);
+            int i = center;
+            int j = MIN(i + 1, binSize - 1);
+            return ofLerp(amplitude[i], amplitude[j], center - i);
+        }
+        int first = static_cast<int>(lo);
+        int last = MIN(static_cast<int>(ceil(hi)), binSize);
+        float v = 0;
+        for (int i = first; i < last; i++) {
+            v = MAX(v, amplitude[i]);
+        }
+        return v;
+    }
+
+    AnalysisConfig _config;
+    vector<float> _bandEdges;
+    int _fftSize = 0, _hopSize = 0, _sampleRate = 0, _binCount = 0;
+    float _smoothing = SMOOTH_FACTOR;
+
+    ofSoundStream _stream;
+    bool _streaming = false;
+    ofxFft* _fft = NULL;
+    OnsetDetector _onsets;
+    Recorder* _recorder = NULL;
+
+    SampleRing _samples;
+    vector<float> _window, _hop;
+    float _smoothedVolume = 0;
+    uint64_t _sequence = 0;
+    Ring _frames;
+
+    thread _thread;
+    atomic<bool> _running{false};
+    mutex _wakeMutex;
+    condition_variable _wake;
+};
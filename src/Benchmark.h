@@ -0,0 +1,185 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SketchCorpus.h"
+#include "SketchIngest.h"
+#include "Kernels.h"
+#include "StateBenchmark.h"
+#include "TileBenchmark.h"
+
+// Command line benchmarks, run as: mophV --bench <name> [args]
+class Benchmark {
+public:
+    static int run(int argc, char* argv[]) {
+        string name = (argc > 2 ? argv[2] : "");
+        vector<string> args;
+        for (int i = 3; i < argc; i++) {
+            args.push_back(argv[i]);
+        }
+
+        if (name == "ingest") {
+            return ingest(args);
+        } else if (name == "kernels") {
+            return kernels();
+        } else if (name == "states") {
+            return StateBenchmark::run(args);
+        } else if (name == "tiles") {
+            return TileBenchmark::run(args);
+        }
+        cerr << "usage: mophV --bench ingest [files...]" << endl;
+        cerr << "       mophV --bench kernels" << endl;
+        cerr << "       mophV --bench states [--frames N] [--warmup N] [--size WxH] [--wav file.wav] [--out file.json] [--baseline file.json]" << endl;
+        cerr << "       mophV --bench tiles [--frames N] [--warmup N] [--size WxH] [--ndjson file.ndjson]" << endl;
+        return 1;
+    }
+
+    // jsoncpp DOM per line vs. chunked SketchIngest on the category files
+    static int ingest(vector<string> files) {
+        if (files.empty()) {
+            files.push_back("full-simplified-cat.ndjson");
+            files.push_back("full-simplified-dog.ndjson");
+            files.push_back("full-simplified-smiley face.ndjson");
+        }
+        const int maxSamples = 10000;
+        const int repeat = 3;
+        int failed = 0;
+
+        for (int i = 0; i < files.size(); i++) {
+            SketchCorpus::Builder reference, streamed;
+            vector<double> legacyMs, ingestMs;
+            for (int r = 0; r < repeat; r++) {
+                double t = now();
+                SketchCorpus::parseNdjson(files[i], reference, maxSamples);
+                legacyMs.push_back(now() - t);
+
+                t = now();
+                SketchIngest::load(files[i], streamed, maxSamples);
+                ingestMs.push_back(now() - t);
+            }
+
+            bool same = reference.strokeOffsets == streamed.strokeOffsets
+                && reference.vertexOffsets == streamed.vertexOffsets
+                && reference.vertices == streamed.vertices;
+            if (!same) {
+                failed++;
+            }
+            double legacy = median(legacyMs);
+            double fast = median(ingestMs);
+            cout << files[i] << ": " << streamed.size() << " drawings"
+                 << ", jsoncpp " << legacy << " ms"
+                 << ", ingest " << fast << " ms"
+                 << " (x" << (fast > 0 ? legacy / fast : 0) << ")"
+                 << (same ? "" : ", OUTPUT DIFFERS") << endl;
+        }
+        return failed == 0 ? 0 : 1;
+    }
+
+    // Kernels against the scalar Util::normalize and Util::calcVolume they replaced
+    static int kernels() {
+        const int sizes[] = {256, 1024, 4096, 16384, 65536};
+        const int elements = 1 << 24;
+        int failed = 0;
+        volatile float sink = 0;
+        cout << "kernels: " << Kernels::getInstructionSet() << endl;
+
+        for (int size : sizes) {
+            vector<float> input(size);
+            for (int i = 0; i < size; i++) {
+                input[i] = ofRandom(-1, 1);
+            }
+            input[size / 3] = NAN;
+            int iterations = elements / size;
+            vector<double> legacyNormalizeMs, normalizeMs, legacyVolumeMs, volumeMs;
+            vector<float> a, b;
+            float legacy = 0, volume = 0;
+            for (int r = 0; r < 3; r++) {
+                double t = now();
+                for (int i = 0; i < iterations; i++) {
+                    a = input;
+                    legacyNormalize(a);
+                }
+                legacyNormalizeMs.push_back(now() - t);
+
+                t = now();
+                for (int i = 0; i < iterations; i++) {
+                    b = input;
+                    Kernels::normalize(b.data(), b.size());
+                }
+                normalizeMs.push_back(now() - t);
+
+                t = now();
+                for (int i = 0; i < iterations; i++) {
+                    legacy += legacyVolume(a);
+                }
+                legacyVolumeMs.push_back(now() - t);
+
+                t = now();
+                for (int i = 0; i < iterations; i++) {
+                    volume += Kernels::rms(b.data(), b.size());
+                }
+                volumeMs.push_back(now() - t);
+            }
+
+            // the legacy normalize passes the NaN through, the kernel zeroes it
+            a[size / 3] = 0;
+            bool same = true;
+            for (int i = 0; i < size; i++) {
+                same = same && fabs(a[i] - b[i]) < 1e-6;
+            }
+            same = same && fabs(legacyVolume(b) - Kernels::rms(b.data(), b.size())) < 1e-4;
+            // an Inf makes the factor 0, and Inf * 0 must come out as 0 rather than NaN
+            vector<float> inf = input;
+            inf[size / 5] = INFINITY;
+            Kernels::normalize(inf.data(), inf.size());
+            for (int i = 0; i < size; i++) {
+                same = same && inf[i] == 0;
+            }
+            if (!same) {
+                failed++;
+            }
+            cout << size << " bins x " << iterations
+                 << ": normalize " << median(legacyNormalizeMs) << " -> " << median(normalizeMs) << " ms"
+                 << ", volume " << median(legacyVolumeMs) << " -> " << median(volumeMs) << " ms"
+                 << (same ? "" : ", OUTPUT DIFFERS") << endl;
+            // keeps the volume loops from being optimized away
+            sink = legacy + volume;
+        }
+        return failed == 0 ? 0 : 1;
+    }
+
+private:
+    // Util::normalize and Util::calcVolume as they were before Kernels
+    static void legacyNormalize(vector<float>& data) {
+        float maxValue = 0;
+        for(int i = 0; i < data.size(); i++) {
+            if(abs(data[i]) > maxValue) {
+                maxValue = abs(data[i]);
+            }
+        }
+        for(int i = 0; i < data.size(); i++) {
+            data[i] /= maxValue;
+        }
+    }
+
+    static float legacyVolume(vector<float>& audio) {
+        float curVol = 0.0;
+        for (int i = 0; i < audio.size(); i++){
+            float val = audio[i];
+            curVol += val * val;
+        }
+        curVol /= (float)audio.size();
+        return sqrt(curVol);
+    }
+
+    static double now() {
+        return chrono::duration<double, milli>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static double median(vector<double> values) {
+        if (values.empty()) {
+            return 0;
+        }
+        sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Ring of history kept in fixed-size chunks, for copying it out without
+// stopping the writer.
+//
+// hold() takes shared references to the chunks covering a range, which is
+// O(chunks). The holder reads them later, on any thread. The writer never
+// reuses a chunk someone still holds: it starts a new one instead, so a
+// reader sees exactly what was there when it held it. The chunk being
+// written can be held too, since the reader stops where the writer was and
+// the writer only writes past that. hold() and push() must not run at the
+// same time.
+template<class T>
+class ChunkRing {
+public:
+    typedef shared_ptr<vector<T> > Chunk;
+
+    // elements [first, last) of the ring as they were when held
+    class Range {
+    public:
+        void read(vector<T>& out) const {
+            out.resize(_last - _first);
+            for (uint64_t i = _first; i < _last;) {
+                size_t offset = i % _chunkSize;
+                size_t n = MIN(_last - i, static_cast<uint64_t>(_chunkSize - offset));
+                const vector<T>& chunk = *_chunks[i / _chunkSize - _firstChunk];
+                copy(chunk.begin() + offset, chunk.begin() + offset + n, out.begin() + (i - _first));
+                i += n;
+            }
+        }
+
+    private:
+        friend class ChunkRing;
+
+        vector<Chunk> _chunks;
+        uint64_t _firstChunk = 0;
+        uint64_t _first = 0;
+        uint64_t _last = 0;
+        size_t _chunkSize = 1;
+    };
+
+    // keeps at least capacity elements, all allocated now
+    void setup(size_t capacity, size_t chunkSize) {
+        _chunkSize = MAX(chunkSize, static_cast<size_t>(1));
+        _chunks.resize(capacity / _chunkSize + 2);
+        for (int i = 0; i < _chunks.size(); i++) {
+            _chunks[i] = Chunk(new vector<T>(_chunkSize));
+        }
+        _total = 0;
+    }
+
+    bool empty() const {
+        return _chunks.empty();
+    }
+
+    // Writer. Allocates only when a chunk it comes back to is still held.
+    void push(const T* values, size_t n) {
+        for (size_t done = 0; done < n;) {
+            size_t offset = _total % _chunkSize;
+            Chunk& chunk = _chunks[(_total / _chunkSize) % _chunks.size()];
+            if (offset == 0 && chunk.use_count() > 1) {
+                chunk = Chunk(new vector<T>(_chunkSize));
+            }
+            size_t m = MIN(n - done, _chunkSize - offset);
+            copy(values + done, values + done + m, chunk->begin() + offset);
+            done += m;
+            _total += m;
+        }
+    }
+
+    // elements pushed so far
+    uint64_t getTotal() const {
+        return _total;
+    }
+
+    // the oldest element still in the ring
+    uint64_t getOldest() const {
+        uint64_t kept = (_chunks.size() - 1) * _chunkSize + _total % _chunkSize;
+        return _total - MIN(_total, kept);
+    }
+
+    // first no older than getOldest(), last no later than getTotal()
+    Range hold(uint64_t first, uint64_t last) const {
+        Range range;
+        range._first = first;
+        range._last = MAX(first, last);
+        range._chunkSize = _chunkSize;
+        range._firstChunk = first / _chunkSize;
+        uint64_t lastChunk = (range._last + _chunkSize - 1) / _chunkSize;
+        for (uint64_t c = range._firstChunk; c < lastChunk; c++) {
+            range._chunks.push_back(_chunks[c % _chunks.size()]);
+        }
+        return range;
+    }
+
+private:
+    vector<Chunk> _chunks;
+    size_t _chunkSize = 1;
+    uint64_t _total = 0;
+};
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxBox2d.h"
+
+// Fixed-capacity set of Box2D circles with one Data slot each.
+//
+// All bodies are created up front and parked inactive. spawn() reactivates a
+// free body and despawn() deactivates it again, so once setup() has run the
+// pool never allocates or destroys anything. Live circles are kept packed at
+// the front of the active list; removal swaps with the last one.
+template<class Data>
+class CirclePool {
+public:
+    void setup(b2World* world, int capacity) {
+        _circles.clear();
+        _data.clear();
+        _circles.resize(capacity);
+        _data.resize(capacity);
+        _active.clear();
+        _active.reserve(capacity);
+        _free.clear();
+        _free.reserve(capacity);
+
+        for (int i = capacity - 1; i >= 0; i--) {
+            ofxBox2dCircle& c = _circles[i];
+            c.setPhysics(1.0, 0.7, 0.9);
+            c.setup(world, 0, -1000, 50);
+            c.setData(&_data[i]);
+            c.body->SetActive(false);
+            _free.push_back(i);
+        }
+    }
+
+    // Returns the data of the new circle, or NULL when the pool is exhausted.
+    Data* spawn(float x, float y, float r) {
+        if (_free.empty()) {
+            return NULL;
+        }
+        int slot = _free.back();
+        _free.pop_back();
+
+        ofxBox2dCircle& c = _circles[slot];
+        c.setRadius(r);
+        c.body->ResetMassData();
+        c.body->SetTransform(b2Vec2(x / OFX_BOX2D_SCALE, y / OFX_BOX2D_SCALE), 0);
+        c.body->SetLinearVelocity(b2Vec2(0, 0));
+        c.body->SetAngularVelocity(0);
+        c.body->SetActive(true);
+        c.body->SetAwake(true);
+
+        _active.push_back(slot);
+        return &_data[slot];
+    }
+
+    // i is a position in the active list, not a slot
+    void despawn(int i) {
+        int slot = _active[i];
+        _circles[slot].body->SetActive(false);
+        _active[i] = _active.back();
+        _active.pop_back();
+        _free.push_back(slot);
+    }
+
+    template<class Predicate>
+    void despawnIf(Predicate predicate) {
+        for (int i = _active.size() - 1; i >= 0; i--) {
+            if (predicate(_circles[_active[i]])) {
+                despawn(i);
+            }
+        }
+    }
+
+    int size() const {
+        return _active.size();
+    }
+
+    int capacity() const {
+        return _circles.size();
+    }
+
+    ofxBox2dCircle& getCircle(int i) {
+        return _circles[_active[i]];
+    }
+
+    Data& getData(int i) {
+        return _data[_active[i]];
+    }
+
+private:
+    vector<ofxBox2dCircle> _circles;
+    vector<Data> _data;
+    vector<int> _active, _free;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "ofMain.h"
+
+// The time states animate by. Live it is oF's elapsed time. An offline render
+// sets it frame by frame instead, so the output is the same however fast the
+// frames are rendered.
+class Clock {
+public:
+    static float getElapsedTimef() {
+        return (fixed() ? fixedSeconds() : ofGetElapsedTimef());
+    }
+
+    static uint64_t getElapsedTimeMillis() {
+        return (fixed() ? static_cast<uint64_t>(fixedSeconds() * 1000.0) : ofGetElapsedTimeMillis());
+    }
+
+    // stops following oF's clock for good
+    static void setFixed(double seconds) {
+        fixedSeconds() = seconds;
+        fixed() = true;
+    }
+
+private:
+    // function statics, this header is included from more than one .cpp
+    static bool& fixed() {
+        static bool f = false;
+        return f;
+    }
+
+    static double& fixedSeconds() {
+        static double t = 0;
+        return t;
+    }
+};
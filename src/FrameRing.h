@@ -0,0 +1,137 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Lock-free single-producer / multi-consumer ring of N preallocated frames.
+//
+// The producer fills a free slot and publishes it as the latest one. Readers
+// pin the latest slot for as long as they hold its Handle; the producer never
+// writes into the latest or a pinned slot, and drops the frame if all slots
+// are taken. Neither side ever blocks the other.
+template<class T, int N>
+class FrameRing {
+public:
+    class Handle {
+    public:
+        Handle() : _ring(NULL), _slot(-1) {
+        }
+
+        Handle(FrameRing* ring, int slot) : _ring(ring), _slot(slot) {
+        }
+
+        Handle(Handle&& other) : _ring(other._ring), _slot(other._slot) {
+            other._ring = NULL;
+        }
+
+        Handle& operator=(Handle&& other) {
+            if (this != &other) {
+                release();
+                _ring = other._ring;
+                _slot = other._slot;
+                other._ring = NULL;
+            }
+            return *this;
+        }
+
+        ~Handle() {
+            release();
+        }
+
+        void release() {
+            if (_ring) {
+                _ring->_pins[_slot].fetch_sub(1);
+                _ring = NULL;
+            }
+        }
+
+        explicit operator bool() const {
+            return _ring != NULL;
+        }
+
+        const T& operator*() const {
+            return _ring->_slots[_slot];
+        }
+
+        const T* operator->() const {
+            return &_ring->_slots[_slot];
+        }
+
+    private:
+        Handle(const Handle&);
+        Handle& operator=(const Handle&);
+
+        FrameRing* _ring;
+        int _slot;
+    };
+
+    FrameRing() : _latest(-1), _writing(-1), _dropped(0) {
+        for (int i = 0; i < N; i++) {
+            _pins[i] = 0;
+        }
+    }
+
+    // Only for preallocating slots before the producer starts.
+    T& at(int i) {
+        return _slots[i];
+    }
+
+    int size() const {
+        return N;
+    }
+
+    // Producer, while it is stopped: forgets the latest frame, so readers get
+    // none until the next publish and the pins left are only ever released.
+    void reset() {
+        _latest.store(-1);
+    }
+
+    // a reader still holds slot i, it must not be touched
+    bool isPinned(int i) const {
+        return _pins[i].load() > 0;
+    }
+
+    // Producer: slot to fill, or NULL when every other slot is pinned.
+    T* beginWrite() {
+        int latest = _latest.load();
+        for (int k = 1; k <= N; k++) {
+            int slot = (MAX(latest, 0) + k) % N;
+            if (slot != latest && _pins[slot].load() == 0) {
+                _writing = slot;
+                return &_slots[slot];
+            }
+        }
+        _dropped++;
+        return NULL;
+    }
+
+    void publish() {
+        _latest.store(_writing);
+    }
+
+    // Consumer: pins and returns the latest frame, empty before the first publish.
+    Handle acquire() {
+        while (true) {
+            int slot = _latest.load();
+            if (slot < 0) {
+                return Handle();
+            }
+            _pins[slot].fetch_add(1);
+            if (_latest.load() == slot) {
+                return Handle(this, slot);
+            }
+            // the producer moved on before the pin landed, try the new one
+            _pins[slot].fetch_sub(1);
+        }
+    }
+
+    uint64_t getDropped() const {
+        return _dropped.load();
+    }
+
+private:
+    T _slots[N];
+    atomic<int> _pins[N];
+    atomic<int> _latest;
+    int _writing;
+    atomic<uint64_t> _dropped;
+};
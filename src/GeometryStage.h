@@ -0,0 +1,72 @@
+#pragma once
+
+#include "ofMain.h"
+#include "WorkerPool.h"
+
+// Builds the next frame's geometry on worker threads while this one draws.
+//
+// launch() queues one job per shape on the pool. A job may only write the
+// back buffer of its own shape, and never touches GL. finish() is the fence:
+// once it returns every job of the last launch has completed, and the render
+// thread can swap and upload what they built. Anything the jobs read must
+// not change between launch() and finish().
+class GeometryStage {
+public:
+    explicit GeometryStage(WorkerPool& pool = WorkerPool::shared()) : _pool(pool) {
+    }
+
+    ~GeometryStage() {
+        finish();
+    }
+
+    // job(i) for i in [0, nJobs), after finishing any previous launch
+    template<class F>
+    void launch(int nJobs, F job) {
+        finish();
+        for (int i = 0; i < nJobs; i++) {
+            _pending.push_back(_pool.submit([job, i]() { job(i); }));
+        }
+        _launched = true;
+    }
+
+    // Waits for the last launch. True if there was one whose results are not yet collected.
+    bool finish() {
+        for (int i = 0; i < _pending.size(); i++) {
+            _pending[i].wait();
+        }
+        _pending.clear();
+        bool launched = _launched;
+        _launched = false;
+        return launched;
+    }
+
+private:
+    WorkerPool& _pool;
+    vector<future<void> > _pending;
+    bool _launched = false;
+};
+
+// Front is what draw() uses, back is what the jobs write. swap() only after the fence.
+template<class T>
+class DoubleBuffer {
+public:
+    T& front() {
+        return _buffers[_front];
+    }
+
+    const T& front() const {
+        return _buffers[_front];
+    }
+
+    T& back() {
+        return _buffers[1 - _front];
+    }
+
+    void swap() {
+        _front = 1 - _front;
+    }
+
+private:
+    T _buffers[2];
+    int _front = 0;
+};
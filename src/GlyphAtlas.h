@@ -0,0 +1,167 @@
+#pragma once
+
+#include "ofMain.h"
+#include "GlyphLodCache.h"
+
+// Glyph outlines of one font, extracted on first use and shared by every string.
+//
+// Each code point is extracted once with all of its contours, holes included,
+// centred on its bounding box and resampled to a fixed point budget. Its
+// smoothing levels go into a GlyphLodCache, which is saved under data/cache so
+// later runs don't even need to load the font for glyphs they have seen.
+class GlyphAtlas {
+public:
+    void setup(string fontFile, int fontSize, int pointsPerGlyph, int nLevels) {
+        _fontFile = fontFile;
+        _fontSize = fontSize;
+        _pointsPerGlyph = pointsPerGlyph;
+        _ranges.assign(ofAlphabet::Latin.begin(), ofAlphabet::Latin.end());
+        _fontLoaded = false;
+
+        string key = fontFile + ":" + ofToString(fontSize) + ":" + ofToString(pointsPerGlyph) + ":" + ofToString(nLevels);
+        _key = GlyphLodCache::hashKey(key);
+        _cacheFile = "cache/glyphs-" + ofToHex(_key) + ".lod";
+        if (!_cache.load(_cacheFile, _key, nLevels)) {
+            _cache.clear(nLevels);
+        }
+        _cache.upload();
+    }
+
+    // One glyph per code point of a UTF-8 string. Glyphs without contours, like spaces, draw nothing.
+    vector<int> getGlyphs(const string& text) {
+        vector<uint32_t> codepoints = decodeUtf8(text);
+        vector<int> glyphs;
+        bool added = false;
+        for (int i = 0; i < codepoints.size(); i++) {
+            int glyph = _cache.find(codepoints[i]);
+            if (glyph < 0) {
+                glyph = _cache.add(codepoints[i], extract(codepoints[i]));
+                added = true;
+            }
+            glyphs.push_back(glyph);
+        }
+        if (added) {
+            _cache.upload();
+            ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(_cacheFile), true, true);
+            if (!_cache.save(_cacheFile, _key)) {
+                ofLogWarning("GlyphAtlas") << "could not write " << _cacheFile;
+            }
+        }
+        return glyphs;
+    }
+
+    int getNumLevels() const {
+        return _cache.getNumLevels();
+    }
+
+    void drawFill(int glyph, int level) const {
+        _cache.drawFill(glyph, level);
+    }
+
+    void drawOutline(int glyph, int level) const {
+        _cache.drawOutline(glyph, level);
+    }
+
+    // invalid sequences become U+FFFD
+    static vector<uint32_t> decodeUtf8(const string& text) {
+        vector<uint32_t> codepoints;
+        const unsigned char* s = reinterpret_cast<const unsigned char*>(text.data());
+        int n = text.size();
+        for (int i = 0; i < n;) {
+            uint32_t c = s[i];
+            int length = (c < 0x80 ? 1 : (c >> 5) == 0x6 ? 2 : (c >> 4) == 0xe ? 3 : (c >> 3) == 0x1e ? 4 : 0);
+            if (length == 0 || i + length > n) {
+                codepoints.push_back(0xfffd);
+                i++;
+                continue;
+            }
+            if (length > 1) {
+                c &= (0x7f >> length);
+                for (int j = 1; j < length; j++) {
+                    if ((s[i + j] & 0xc0) != 0x80) {
+                        c = 0xfffd;
+                        length = j;
+                        break;
+                    }
+                    c = (c << 6) | (s[i + j] & 0x3f);
+                }
+            }
+            codepoints.push_back(c);
+            i += length;
+        }
+        return codepoints;
+    }
+
+private:
+    vector<ofPolyline> extract(uint32_t codepoint) {
+        if (!hasCodepoint(codepoint)) {
+            _ranges.push_back(ofUnicode::range{codepoint, codepoint});
+            _fontLoaded = false;
+        }
+        if (!_fontLoaded) {
+            ofTrueTypeFontSettings settings(_fontFile, _fontSize);
+            settings.antialiased = true;
+            settings.contours = true;
+            settings.ranges = _ranges;
+            _fontLoaded = _font.load(settings);
+        }
+
+        vector<ofPolyline> contours;
+        if (!_fontLoaded) {
+            return contours;
+        }
+        vector<ofPolyline> outlines = _font.getCharacterAsPoints(codepoint).getOutline();
+
+        ofRectangle bb;
+        float perimeter = 0;
+        for (int i = 0; i < outlines.size(); i++) {
+            if (outlines[i].size() < 3) {
+                continue;
+            }
+            if (contours.empty()) {
+                bb = outlines[i].getBoundingBox();
+            } else {
+                bb.growToInclude(outlines[i].getBoundingBox());
+            }
+            perimeter += outlines[i].getPerimeter();
+            contours.push_back(outlines[i]);
+        }
+        if (perimeter <= 0) {
+            contours.clear();
+            return contours;
+        }
+
+        // the point budget is split by contour length so holes keep the same spacing
+        ofPoint center(bb.x + bb.width * 0.5, bb.y + bb.height * 0.5);
+        for (int i = 0; i < contours.size(); i++) {
+            int count = MAX(8, static_cast<int>(_pointsPerGlyph * contours[i].getPerimeter() / perimeter));
+            ofPolyline resampled = contours[i].getResampledByCount(count);
+            contours[i].clear();
+            for (int j = 0; j < resampled.size(); j++) {
+                contours[i].addVertex(resampled[j].x - center.x, resampled[j].y - center.y);
+            }
+            contours[i].close();
+        }
+        return contours;
+    }
+
+    bool hasCodepoint(uint32_t codepoint) const {
+        for (int i = 0; i < _ranges.size(); i++) {
+            if (_ranges[i].begin <= codepoint && codepoint <= _ranges[i].end) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    string _fontFile;
+    int _fontSize = 0;
+    int _pointsPerGlyph = 0;
+    vector<ofUnicode::range> _ranges;
+    ofTrueTypeFont _font;
+    bool _fontLoaded = false;
+
+    uint32_t _key = 0;
+    string _cacheFile;
+    GlyphLodCache _cache;
+};
@@ -0,0 +1,278 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Every smoothing level of a set of glyphs, with its fill, in one vbo.
+//
+// A glyph is a set of closed contours, holes included. Level l of a glyph is
+// each contour's getSmoothed(l + 1, 0) and the NONZERO tessellation of all of
+// them, so drawing a level is a lookup instead of a smooth and a tessellate
+// per frame. Glyphs are added under an id (GlyphAtlas uses the code point) and
+// the table can be saved and loaded back:
+//
+//   Header
+//   uint32  ids[nGlyphs]
+//   Level   levels[nGlyphs * nLevels]   ranges into the arrays below
+//   Contour contours[nContours]         outline ranges of vertices
+//   float   vertices[nVertices * 2]     outline points, then fill vertices, of each level
+//   uint32  indices[nIndices]           fill triangles, indexing vertices directly
+class GlyphLodCache {
+public:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t key;
+        uint32_t nGlyphs;
+        uint32_t nLevels;
+        uint32_t nContours;
+        uint32_t nVertices;
+        uint32_t nIndices;
+    };
+
+    struct Level {
+        uint32_t contourOffset;
+        uint32_t contourCount;
+        uint32_t indexOffset;
+        uint32_t indexCount;
+    };
+
+    struct Contour {
+        uint32_t vertexOffset;
+        uint32_t vertexCount;
+    };
+
+    void clear(int nLevels) {
+        _nLevels = nLevels;
+        _ids.clear();
+        _glyphs.clear();
+        _levels.clear();
+        _contours.clear();
+        _vertices.clear();
+        _indices.clear();
+        _dirty = true;
+    }
+
+    // -1 when id has not been added
+    int find(uint32_t id) const {
+        map<uint32_t, int>::const_iterator it = _glyphs.find(id);
+        return (it == _glyphs.end() ? -1 : it->second);
+    }
+
+    int add(uint32_t id, const vector<ofPolyline>& contours) {
+        ofTessellator tessellator;
+        ofMesh mesh;
+        vector<ofPolyline> smoothed(contours.size());
+        for (int l = 0; l < _nLevels; l++) {
+            for (int c = 0; c < contours.size(); c++) {
+                smoothed[c] = contours[c].getSmoothed(l + 1, 0.0);
+            }
+            if (!smoothed.empty()) {
+                tessellator.tessellateToMesh(smoothed, OF_POLY_WINDING_NONZERO, mesh);
+            } else {
+                mesh.clear();
+            }
+
+            Level level;
+            level.contourOffset = _contours.size();
+            level.contourCount = smoothed.size();
+            for (int c = 0; c < smoothed.size(); c++) {
+                Contour contour;
+                contour.vertexOffset = _vertices.size() / 2;
+                contour.vertexCount = smoothed[c].size();
+                for (int i = 0; i < smoothed[c].size(); i++) {
+                    _vertices.push_back(smoothed[c][i].x);
+                    _vertices.push_back(smoothed[c][i].y);
+                }
+                _contours.push_back(contour);
+            }
+            uint32_t fillOffset = _vertices.size() / 2;
+            for (int i = 0; i < mesh.getNumVertices(); i++) {
+                _vertices.push_back(mesh.getVertex(i).x);
+                _vertices.push_back(mesh.getVertex(i).y);
+            }
+            level.indexOffset = _indices.size();
+            if (mesh.getNumIndices() > 0) {
+                for (int i = 0; i < mesh.getNumIndices(); i++) {
+                    _indices.push_back(fillOffset + mesh.getIndex(i));
+                }
+            } else {
+                for (int i = 0; i < mesh.getNumVertices(); i++) {
+                    _indices.push_back(fillOffset + i);
+                }
+            }
+            level.indexCount = _indices.size() - level.indexOffset;
+            _levels.push_back(level);
+        }
+
+        int glyph = _ids.size();
+        _ids.push_back(id);
+        _glyphs[id] = glyph;
+        _dirty = true;
+        return glyph;
+    }
+
+    // sends added glyphs to the vbo, once per batch of add()
+    void upload() {
+        if (!_dirty) {
+            return;
+        }
+        _vbo.clear();
+        if (!_vertices.empty()) {
+            _vbo.setVertexData(_vertices.data(), 2, _vertices.size() / 2, GL_STATIC_DRAW);
+            _vbo.setIndexData(_indices.data(), _indices.size(), GL_STATIC_DRAW);
+        }
+        _dirty = false;
+    }
+
+    // nLevels is the number of levels the caller builds, a table with any other count is refused
+    bool load(string filename, uint32_t key, int nLevels) {
+        ifstream in(ofToDataPath(filename, true).c_str(), ios::binary);
+        Header header;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+        if (memcmp(header.magic, "MGLC", 4) != 0 || header.version != VERSION || header.key != key) {
+            return false;
+        }
+        if (header.nLevels == 0 || header.nLevels != static_cast<uint32_t>(nLevels)) {
+            return false;
+        }
+        // in 64 bits, so counts near 2^32 cannot wrap past the check
+        uint64_t expected = sizeof(Header)
+            + sizeof(uint32_t) * static_cast<uint64_t>(header.nGlyphs)
+            + sizeof(Level) * static_cast<uint64_t>(header.nGlyphs) * header.nLevels
+            + sizeof(Contour) * static_cast<uint64_t>(header.nContours)
+            + sizeof(float) * 2 * static_cast<uint64_t>(header.nVertices)
+            + sizeof(uint32_t) * static_cast<uint64_t>(header.nIndices);
+        in.seekg(0, ios::end);
+        uint64_t size = in.tellg();
+        in.seekg(sizeof(Header), ios::beg);
+        if (!in || size != expected) {
+            return false;
+        }
+        vector<uint32_t> ids(header.nGlyphs);
+        vector<Level> levels(static_cast<size_t>(header.nGlyphs) * header.nLevels);
+        vector<Contour> contours(header.nContours);
+        vector<float> vertices(static_cast<size_t>(header.nVertices) * 2);
+        vector<uint32_t> indices(header.nIndices);
+        in.read(reinterpret_cast<char*>(ids.data()), sizeof(uint32_t) * ids.size());
+        in.read(reinterpret_cast<char*>(levels.data()), sizeof(Level) * levels.size());
+        in.read(reinterpret_cast<char*>(contours.data()), sizeof(Contour) * contours.size());
+        in.read(reinterpret_cast<char*>(vertices.data()), sizeof(float) * vertices.size());
+        in.read(reinterpret_cast<char*>(indices.data()), sizeof(uint32_t) * indices.size());
+        if (!in) {
+            return false;
+        }
+        for (int i = 0; i < levels.size(); i++) {
+            const Level& l = levels[i];
+            if (l.contourOffset > header.nContours || l.contourCount > header.nContours - l.contourOffset
+                || l.indexOffset > header.nIndices || l.indexCount > header.nIndices - l.indexOffset) {
+                return false;
+            }
+        }
+        for (int i = 0; i < contours.size(); i++) {
+            const Contour& c = contours[i];
+            if (c.vertexOffset > header.nVertices || c.vertexCount > header.nVertices - c.vertexOffset) {
+                return false;
+            }
+        }
+        for (int i = 0; i < indices.size(); i++) {
+            if (indices[i] >= header.nVertices) {
+                return false;
+            }
+        }
+
+        clear(header.nLevels);
+        _ids.swap(ids);
+        for (int i = 0; i < _ids.size(); i++) {
+            _glyphs[_ids[i]] = i;
+        }
+        _levels.swap(levels);
+        _contours.swap(contours);
+        _vertices.swap(vertices);
+        _indices.assign(indices.begin(), indices.end());
+        return true;
+    }
+
+    bool save(string filename, uint32_t key) const {
+        Header header;
+        memcpy(header.magic, "MGLC", 4);
+        header.version = VERSION;
+        header.key = key;
+        header.nGlyphs = _ids.size();
+        header.nLevels = _nLevels;
+        header.nContours = _contours.size();
+        header.nVertices = _vertices.size() / 2;
+        header.nIndices = _indices.size();
+        vector<uint32_t> indices(_indices.begin(), _indices.end());
+
+        string path = ofToDataPath(filename, true);
+        string tmp = path + ".tmp";
+        ofstream out(tmp.c_str(), ios::binary | ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(_ids.data()), sizeof(uint32_t) * _ids.size());
+        out.write(reinterpret_cast<const char*>(_levels.data()), sizeof(Level) * _levels.size());
+        out.write(reinterpret_cast<const char*>(_contours.data()), sizeof(Contour) * _contours.size());
+        out.write(reinterpret_cast<const char*>(_vertices.data()), sizeof(float) * _vertices.size());
+        out.write(reinterpret_cast<const char*>(indices.data()), sizeof(uint32_t) * indices.size());
+        out.close();
+        if (!out) {
+            remove(tmp.c_str());
+            return false;
+        }
+        return rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    int getNumGlyphs() const {
+        return _ids.size();
+    }
+
+    int getNumLevels() const {
+        return _nLevels;
+    }
+
+    void drawFill(int glyph, int level) const {
+        const Level& l = getLevel(glyph, level);
+        if (l.indexCount > 0) {
+            _vbo.drawElements(GL_TRIANGLES, l.indexCount, l.indexOffset);
+        }
+    }
+
+    void drawOutline(int glyph, int level) const {
+        const Level& l = getLevel(glyph, level);
+        for (int c = 0; c < l.contourCount; c++) {
+            const Contour& contour = _contours[l.contourOffset + c];
+            _vbo.draw(GL_LINE_LOOP, contour.vertexOffset, contour.vertexCount);
+        }
+    }
+
+    // FNV-1a, stable across runs and platforms
+    static uint32_t hashKey(const string& key) {
+        uint32_t h = 2166136261u;
+        for (int i = 0; i < key.size(); i++) {
+            h = (h ^ static_cast<uint8_t>(key[i])) * 16777619u;
+        }
+        return h;
+    }
+
+private:
+    static const uint32_t VERSION = 2;
+
+    const Level& getLevel(int glyph, int level) const {
+        level = ofClamp(level, 0, _nLevels - 1);
+        return _levels[glyph * _nLevels + level];
+    }
+
+    int _nLevels = 0;
+    vector<uint32_t> _ids;
+    map<uint32_t, int> _glyphs;
+    vector<Level> _levels;
+    vector<Contour> _contours;
+    vector<float> _vertices;
+    vector<ofIndexType> _indices;
+    bool _dirty = false;
+    ofVbo _vbo;
+};
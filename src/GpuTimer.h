@@ -0,0 +1,161 @@
+#pragma once
+
+#include "ofMain.h"
+#include "PhaseTimer.h"
+
+// GPU time of the Draw and Post phases, from GL timer queries.
+//
+// ofApp brackets each frame with beginFrame()/endFrame() and the code of a
+// phase opens a Scope. Time-elapsed queries cannot nest, so a Scope ends the
+// enclosing phase's query, starts its own, and resumes the enclosing one
+// when it closes: Draw is the frame without the Post inside it. Results are
+// read FRAME_LATENCY frames later, once the GPU has them, so nothing waits
+// on the GPU. Render thread only. Needs ARB_timer_query or EXT_timer_query,
+// and does nothing without them or while PhaseTimer is off.
+class GpuTimer {
+public:
+    class Scope {
+    public:
+        explicit Scope(PhaseTimer::Phase phase) : _open(push(phase)) {
+        }
+
+        ~Scope() {
+            if (_open) {
+                pop();
+            }
+        }
+
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+
+        bool _open;
+    };
+
+    static const int FRAME_LATENCY = 3;
+
+    static bool isSupported() {
+        State& s = state();
+        if (!s.checked) {
+            s.checked = true;
+            s.supported = (GLEW_ARB_timer_query || GLEW_EXT_timer_query);
+            if (!s.supported) {
+                ofLogNotice("GpuTimer") << "no timer queries, GPU times are off";
+            }
+        }
+        return s.supported;
+    }
+
+    // reads back the oldest frame in flight and starts the Draw phase
+    static void beginFrame() {
+        State& s = state();
+        s.running = PhaseTimer::isEnabled() && isSupported();
+        if (!s.running) {
+            return;
+        }
+        s.frame++;
+        Frame& f = s.frames[s.frame % (FRAME_LATENCY + 1)];
+        if (f.used > 0) {
+            read(f);
+        }
+        f.used = 0;
+        push(PhaseTimer::Draw);
+    }
+
+    static void endFrame() {
+        State& s = state();
+        if (s.running) {
+            pop();
+            s.running = false;
+        }
+    }
+
+    // milliseconds per phase of the last frame read back, 0 for the CPU-only phases
+    static void collect(double ms[PhaseTimer::PHASE_COUNT]) {
+        State& s = state();
+        for (int i = 0; i < PhaseTimer::PHASE_COUNT; i++) {
+            ms[i] = s.ms[i];
+        }
+    }
+
+private:
+    struct Frame {
+        vector<GLuint> queries;
+        vector<PhaseTimer::Phase> phases;
+        int used = 0;
+    };
+
+    struct State {
+        bool checked = false;
+        bool supported = false;
+        bool running = false;
+        uint64_t frame = 0;
+        Frame frames[FRAME_LATENCY + 1];
+        vector<PhaseTimer::Phase> stack;
+        double ms[PhaseTimer::PHASE_COUNT] = {};
+    };
+
+    static bool push(PhaseTimer::Phase phase) {
+        State& s = state();
+        if (!s.running) {
+            return false;
+        }
+        if (!s.stack.empty()) {
+            glEndQuery(GL_TIME_ELAPSED);
+        }
+        s.stack.push_back(phase);
+        start(phase);
+        return true;
+    }
+
+    static void pop() {
+        State& s = state();
+        glEndQuery(GL_TIME_ELAPSED);
+        s.stack.pop_back();
+        if (!s.stack.empty()) {
+            start(s.stack.back());
+        }
+    }
+
+    static void start(PhaseTimer::Phase phase) {
+        State& s = state();
+        Frame& f = s.frames[s.frame % (FRAME_LATENCY + 1)];
+        if (f.used == f.queries.size()) {
+            GLuint query;
+            glGenQueries(1, &query);
+            f.queries.push_back(query);
+            f.phases.push_back(phase);
+        }
+        f.phases[f.used] = phase;
+        glBeginQuery(GL_TIME_ELAPSED, f.queries[f.used]);
+        f.used++;
+    }
+
+    // Keeps the previous results when the GPU is still more than FRAME_LATENCY frames behind
+    static void read(const Frame& f) {
+        GLint available = 0;
+        glGetQueryObjectiv(f.queries[f.used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return;
+        }
+        State& s = state();
+        for (int i = 0; i < PhaseTimer::PHASE_COUNT; i++) {
+            s.ms[i] = 0;
+        }
+        for (int i = 0; i < f.used; i++) {
+            GLuint64 ns = 0;
+            if (GLEW_ARB_timer_query) {
+                glGetQueryObjectui64v(f.queries[i], GL_QUERY_RESULT, &ns);
+            } else {
+                glGetQueryObjectui64vEXT(f.queries[i], GL_QUERY_RESULT, &ns);
+            }
+            s.ms[f.phases[i]] += ns / 1e6;
+        }
+    }
+
+    // function static, this header is included from more than one .cpp
+    static State& state() {
+        static State s;
+        return s;
+    }
+};
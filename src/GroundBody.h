@@ -0,0 +1,84 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxBox2d.h"
+#include "SpectrumTerrain.h"
+
+// Box2D side of the spectrum ground.
+//
+// One static body with a fixed set of edge fixtures is created once. When the
+// terrain moves the edge vertices are rewritten in place and the broadphase is
+// resynchronised, so contacts with resting bodies survive from frame to frame.
+class GroundBody {
+public:
+    ~GroundBody() {
+        destroy();
+    }
+
+    void setup(b2World* world, const SpectrumTerrain& terrain, float width, float height) {
+        destroy();
+        _world = world;
+
+        b2BodyDef bodyDef;
+        bodyDef.type = b2_staticBody;
+        _body = _world->CreateBody(&bodyDef);
+
+        // bottom left, two corners per column, bottom right
+        int nPoints = terrain.getNumColumns() * 2 + 2;
+        _points.assign(nPoints, b2Vec2(0, 0));
+        for (int i = 0; i < nPoints - 1; i++) {
+            b2EdgeShape shape;
+            shape.Set(b2Vec2(0, 0), b2Vec2(0, 0));
+            b2FixtureDef fixture;
+            fixture.shape = &shape;
+            fixture.density = 0;
+            fixture.friction = 0;
+            fixture.restitution = 0;
+            _edges.push_back(_body->CreateFixture(&fixture));
+        }
+        update(terrain, width, height);
+    }
+
+    void update(const SpectrumTerrain& terrain, float width, float height) {
+        if (_body == NULL) {
+            return;
+        }
+        int n = 0;
+        _points[n++] = toWorld(0, height);
+        for (int i = 0; i < terrain.getNumColumns(); i++) {
+            _points[n++] = toWorld(terrain.getLeft(i), terrain.getHeight(i));
+            _points[n++] = toWorld(terrain.getRight(i), terrain.getHeight(i));
+        }
+        _points[n++] = toWorld(width, height);
+
+        for (int i = 0; i < _edges.size(); i++) {
+            b2EdgeShape* edge = static_cast<b2EdgeShape*>(_edges[i]->GetShape());
+            edge->Set(_points[i], _points[i + 1]);
+        }
+        // refreshes fixture AABBs in the broadphase without touching contacts
+        _body->SetTransform(_body->GetPosition(), _body->GetAngle());
+
+        // bodies asleep on a column that moved would otherwise hang in the air
+        for (b2ContactEdge* c = _body->GetContactList(); c; c = c->next) {
+            c->other->SetAwake(true);
+        }
+    }
+
+    void destroy() {
+        if (_world != NULL && _body != NULL) {
+            _world->DestroyBody(_body);
+        }
+        _body = NULL;
+        _edges.clear();
+    }
+
+private:
+    static b2Vec2 toWorld(float x, float y) {
+        return b2Vec2(x / OFX_BOX2D_SCALE, y / OFX_BOX2D_SCALE);
+    }
+
+    b2World* _world = NULL;
+    b2Body* _body = NULL;
+    vector<b2Fixture*> _edges;
+    vector<b2Vec2> _points;
+};
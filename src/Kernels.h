@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+// Float kernels for the spectrum and volume paths, on (pointer, count) spans.
+//
+// The vector path is chosen at compile time: AVX2 when the target enables it
+// (-mavx2), SSE2 on any x86_64 build, plain C++ otherwise. All paths treat NaN
+// as 0, so normalized output never contains NaN. Do not build this with
+// -ffast-math, which lets the compiler assume there are no NaNs to remove.
+class Kernels {
+public:
+    static const char* getInstructionSet() {
+#if defined(__AVX2__)
+        return "avx2";
+#elif defined(__SSE2__) || defined(_M_X64)
+        return "sse2";
+#else
+        return "scalar";
+#endif
+    }
+
+    // Largest |x|, ignoring NaN
+    static float maxAbs(const float* data, size_t n) {
+        size_t i = 0;
+        float m = 0;
+#if defined(__AVX2__)
+        const __m256 mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        for (; i + 16 <= n; i += 16) {
+            // max_ps returns its second operand when either one is NaN
+            acc0 = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(data + i), mask), acc0);
+            acc1 = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(data + i + 8), mask), acc1);
+        }
+        acc0 = _mm256_max_ps(acc0, acc1);
+        m = horizontalMax(_mm_max_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1)));
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128 mask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (; i + 8 <= n; i += 8) {
+            acc0 = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(data + i), mask), acc0);
+            acc1 = _mm_max_ps(_mm_and_ps(_mm_loadu_ps(data + i + 4), mask), acc1);
+        }
+        m = horizontalMax(_mm_max_ps(acc0, acc1));
+#endif
+        for (; i < n; i++) {
+            float v = fabsf(data[i]);
+            if (v > m) {
+                m = v;
+            }
+        }
+        return m;
+    }
+
+    // out[i] = in[i] * factor, NaN becomes 0, as does Inf * 0. in and out may be the same span.
+    static void scale(const float* in, float* out, size_t n, float factor) {
+        size_t i = 0;
+#if defined(__AVX2__)
+        const __m256 f = _mm256_set1_ps(factor);
+        for (; i + 8 <= n; i += 8) {
+            // on the product, so Inf * 0 is caught too
+            __m256 p = _mm256_mul_ps(_mm256_loadu_ps(in + i), f);
+            _mm256_storeu_ps(out + i, _mm256_and_ps(p, _mm256_cmp_ps(p, p, _CMP_ORD_Q)));
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128 f = _mm_set1_ps(factor);
+        for (; i + 4 <= n; i += 4) {
+            __m128 p = _mm_mul_ps(_mm_loadu_ps(in + i), f);
+            _mm_storeu_ps(out + i, _mm_and_ps(p, _mm_cmpord_ps(p, p)));
+        }
+#endif
+        for (; i < n; i++) {
+            float x = in[i] * factor;
+            out[i] = (x == x ? x : 0);
+        }
+    }
+
+    // Scales into -1..1 by the largest |x|. All zeros when there is no signal.
+    static void normalize(float* data, size_t n) {
+        float m = maxAbs(data, n);
+        scale(data, data, n, (m > 0 ? 1.0f / m : 0));
+    }
+
+    // Sum of x * x, NaN counting as 0
+    static float sumOfSquares(const float* data, size_t n) {
+        size_t i = 0;
+        float sum = 0;
+#if defined(__AVX2__)
+        __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+        for (; i + 16 <= n; i += 16) {
+            __m256 a = _mm256_loadu_ps(data + i);
+            __m256 b = _mm256_loadu_ps(data + i + 8);
+            a = _mm256_and_ps(a, _mm256_cmp_ps(a, a, _CMP_ORD_Q));
+            b = _mm256_and_ps(b, _mm256_cmp_ps(b, b, _CMP_ORD_Q));
+            acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(a, a));
+            acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(b, b));
+        }
+        acc0 = _mm256_add_ps(acc0, acc1);
+        sum = horizontalSum(_mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1)));
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+        for (; i + 8 <= n; i += 8) {
+            __m128 a = _mm_loadu_ps(data + i);
+            __m128 b = _mm_loadu_ps(data + i + 4);
+            a = _mm_and_ps(a, _mm_cmpord_ps(a, a));
+            b = _mm_and_ps(b, _mm_cmpord_ps(b, b));
+            acc0 = _mm_add_ps(acc0, _mm_mul_ps(a, a));
+            acc1 = _mm_add_ps(acc1, _mm_mul_ps(b, b));
+        }
+        sum = horizontalSum(_mm_add_ps(acc0, acc1));
+#endif
+        for (; i < n; i++) {
+            float x = data[i];
+            sum += (x == x ? x * x : 0);
+        }
+        return sum;
+    }
+
+    static float rms(const float* data, size_t n) {
+        return (n > 0 ? sqrtf(sumOfSquares(data, n) / n) : 0);
+    }
+
+private:
+#if defined(__AVX2__) || defined(__SSE2__) || defined(_M_X64)
+    static float horizontalMax(__m128 v) {
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_max_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(v);
+    }
+
+    static float horizontalSum(__m128 v) {
+        v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtss_f32(v);
+    }
+#endif
+};
@@ -0,0 +1,199 @@
+#pragma once
+
+#include "ofMain.h"
+#include "AudioAnalyzer.h"
+#include "WavFile.h"
+#include "WorkerPool.h"
+#include "Clock.h"
+
+// Renders a WAV file to frames without the input device or the real-time clock.
+//
+//   mophV --render song.wav [--state Shapes] [--mode 2] [--size 1920x1080] [--fps 60] [--out frames]
+//
+// Each frame sets Clock to frame / fps, feeds the analyzer exactly that
+// frame's samples and renders into an fbo at the output size, so a file
+// always renders to the same frames and as fast as the GPU allows. --out is
+// a folder of numbered PNGs, written on their own threads, or - for raw
+// RGBA frames on stdout:
+//
+//   mophV --render song.wav --out - | ffmpeg -f rawvideo -pix_fmt rgba -s 1920x1080 -r 60 -i - out.mp4
+class OfflineRender {
+public:
+    struct Settings {
+        string audioFile;
+        string state = "Shapes";
+        int mode = 0;    // OF_KEY_RIGHT presses after the state starts
+        int width = 1920;
+        int height = 1080;
+        int fps = 60;
+        string out = "render";
+
+        bool isEnabled() const {
+            return !audioFile.empty();
+        }
+
+        bool isRaw() const {
+            return out == "-";
+        }
+
+        // argv[1] is --render. False, with a message, on anything it cannot use.
+        bool parse(int argc, char* argv[]) {
+            for (int i = 2; i < argc; i++) {
+                string arg = argv[i];
+                bool hasValue = (i + 1 < argc);
+                if (arg == "--state" && hasValue) {
+                    state = argv[++i];
+                } else if (arg == "--mode" && hasValue) {
+                    mode = ofToInt(argv[++i]);
+                } else if (arg == "--size" && hasValue) {
+                    vector<string> size = ofSplitString(argv[++i], "x");
+                    if (size.size() != 2) {
+                        cerr << "--size is WIDTHxHEIGHT" << endl;
+                        return false;
+                    }
+                    width = ofToInt(size[0]);
+                    height = ofToInt(size[1]);
+                } else if (arg == "--fps" && hasValue) {
+                    fps = ofToInt(argv[++i]);
+                } else if (arg == "--out" && hasValue) {
+                    out = argv[++i];
+                } else if (audioFile.empty() && arg.compare(0, 2, "--") != 0) {
+                    audioFile = arg;
+                } else {
+                    cerr << "unknown argument " << arg << endl;
+                    return false;
+                }
+            }
+            if (audioFile.empty() || width <= 0 || height <= 0 || fps <= 0 || mode < 0) {
+                cerr << "usage: mophV --render file.wav [--state NAME] [--mode N] [--size WxH] [--fps N] [--out DIR|-]" << endl;
+                return false;
+            }
+            return true;
+        }
+    };
+
+    ~OfflineRender() {
+        finish();
+    }
+
+    void setSettings(const Settings& settings) {
+        _settings = settings;
+    }
+
+    const Settings& getSettings() const {
+        return _settings;
+    }
+
+    bool isEnabled() const {
+        return _settings.isEnabled();
+    }
+
+    // Loads the audio and starts the analyzer without a device. False if the file is unusable.
+    bool setup(AudioAnalyzer& analyzer, AnalysisConfig config) {
+        if (!_wav.load(_settings.audioFile)) {
+            _status = 1;
+            return false;
+        }
+        config.sampleRate = _wav.getSampleRate();
+        analyzer.setupOffline(config);
+        _analyzer = &analyzer;
+        _frame = 0;
+        _nFrames = ceil(_wav.getDuration() * _settings.fps);
+
+        _fbo.allocate(_settings.width, _settings.height, GL_RGBA);
+        if (!_settings.isRaw()) {
+            ofDirectory::createDirectory(_settings.out, true, true);
+            _writers.reset(new WorkerPool(2));
+        }
+        ofSeedRandom(0);
+        ofSetVerticalSync(false);
+        ofSetFrameRate(0);
+        Clock::setFixed(0);
+        _startTime = ofGetElapsedTimef();
+        return true;
+    }
+
+    // Moves to the next frame. Once the audio has run out, or setup() failed, it is
+    // false and the app exits when the last frames are written.
+    bool advance() {
+        if (_frame >= _nFrames) {
+            if (_rendering) {
+                finish();
+                ofExit(_status);
+            }
+            _rendering = false;
+            return false;
+        }
+        _rendering = true;
+        const vector<float>& samples = _wav.getSamples();
+        int rate = _wav.getSampleRate();
+        int from = MIN(static_cast<int64_t>(_frame) * rate / _settings.fps, static_cast<int64_t>(samples.size()));
+        int to = MIN(static_cast<int64_t>(_frame + 1) * rate / _settings.fps, static_cast<int64_t>(samples.size()));
+        Clock::setFixed(static_cast<double>(_frame) / _settings.fps);
+        _analyzer->process(samples.data() + from, to - from);
+        return true;
+    }
+
+    // false when there is no frame to draw
+    bool begin() {
+        if (!_rendering) {
+            return false;
+        }
+        _fbo.begin();
+        ofClear(0, 255);
+        return true;
+    }
+
+    void end() {
+        _fbo.end();
+        _fbo.readToPixels(_pixels);
+        if (_settings.isRaw()) {
+            fwrite(_pixels.getData(), 1, _pixels.getWidth() * _pixels.getHeight() * _pixels.getNumChannels(), stdout);
+        } else {
+            string path = _settings.out + "/frame-" + ofToString(_frame, 5, '0') + ".png";
+            if (_frame == 0) {
+                // the first save initializes FreeImage, which is not safe to race
+                ofSaveImage(_pixels, path);
+            } else {
+                ofPixels pixels = _pixels;
+                _pending.push_back(_writers->submit([pixels, path]() { ofSaveImage(pixels, path); }));
+                // bounded, so a slow disk holds the render back instead of filling memory
+                while (_pending.size() > MAX_PENDING_WRITES) {
+                    _pending.front().wait();
+                    _pending.pop_front();
+                }
+            }
+        }
+        _frame++;
+        if (_frame % _settings.fps == 0 || _frame == _nFrames) {
+            float elapsed = ofGetElapsedTimef() - _startTime;
+            cerr << "frame " << _frame << " / " << _nFrames << ", " << ofToString(static_cast<float>(_frame) / _settings.fps / MAX(elapsed, 0.001f), 2) << "x real time" << endl;
+        }
+    }
+
+    // waits for the frames still being written
+    void finish() {
+        while (!_pending.empty()) {
+            _pending.front().wait();
+            _pending.pop_front();
+        }
+        fflush(stdout);
+    }
+
+private:
+    static const int MAX_PENDING_WRITES = 8;
+
+    Settings _settings;
+    WavFile _wav;
+    AudioAnalyzer* _analyzer = NULL;
+    int _frame = 0;
+    int _nFrames = 0;
+    bool _rendering = true;
+    int _status = 0;
+    float _startTime = 0;
+
+    ofFbo _fbo;
+    ofPixels _pixels;
+    unique_ptr<WorkerPool> _writers;
+    deque<future<void> > _pending;
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include "ofMain.h"
+#include "AnalysisConfig.h"
+#include "AnalysisFrame.h"
+
+// Onsets per band from spectral flux, run by AudioAnalyzer once per hop.
+//
+// The frame's values are split into AnalysisConfig::onsetBands equal bands.
+// A band's flux is the mean rise of its log-compressed values since the last
+// hop, falls ignored. The band has an onset when its flux is rising, is above
+// onsetThreshold times the median of the last onsetWindow seconds of its
+// flux plus onsetDelta, and its last onset is at least onsetInterval ago.
+// Values are compared before the analyzer's normalization, so a louder frame
+// elsewhere in the spectrum does not look like a fall here. Everything is
+// allocated by setup(): a hop costs one pass over the values plus a median
+// per band.
+//
+// Results go into every frame as a running count and the audio time of the
+// latest onset per band. OnsetReader turns those into "fired since I last
+// looked", so a state that reads one frame in three still sees every onset.
+class OnsetDetector {
+public:
+    void setup(const AnalysisConfig& config) {
+        _config = config;
+        _nBands = MAX(1, MIN(config.onsetBands, config.bandCount));
+        _nValues = config.bandCount;
+        _history = MAX(3, static_cast<int>(config.onsetWindow * config.sampleRate / config.hopSize));
+        _last.assign(_nValues, 0);
+        _flux.assign(_nBands * _history, 0);
+        _previousFlux.assign(_nBands, 0);
+        _scratch.assign(_history, 0);
+        _count.assign(_nBands, 0);
+        _time.assign(_nBands, -1e9);
+        _hops = 0;
+    }
+
+    int getNumBands() const {
+        return _nBands;
+    }
+
+    // the band that value i of a frame belongs to
+    static int bandOf(int i, int nValues, int nBands) {
+        return ofClamp(static_cast<int64_t>(i) * nBands / MAX(1, nValues), 0, nBands - 1);
+    }
+
+    // Normalized values and the peak they were divided by, at audio time `time`.
+    // Writes the running counts and times into frame.
+    void process(const float* values, float peak, double time, AnalysisFrame& frame) {
+        int slot = _hops % _history;
+        int filled = MIN(_hops, static_cast<uint64_t>(_history));
+        for (int b = 0; b < _nBands; b++) {
+            int first = static_cast<int64_t>(b) * _nValues / _nBands;
+            int last = static_cast<int64_t>(b + 1) * _nValues / _nBands;
+            float rise = 0;
+            for (int i = first; i < last; i++) {
+                float v = log1p(values[i] * peak);
+                rise += MAX(0.0f, v - _last[i]);
+                _last[i] = v;
+            }
+            float flux = (last > first ? rise / (last - first) : 0);
+
+            float* history = _flux.data() + b * _history;
+            if (filled >= 3) {
+                float threshold = median(history, filled) * _config.onsetThreshold + _config.onsetDelta;
+                bool rising = flux > _previousFlux[b];
+                if (rising && flux > threshold && time - _time[b] >= _config.onsetInterval) {
+                    _count[b]++;
+                    _time[b] = time;
+                }
+            }
+            history[slot] = flux;
+            _previousFlux[b] = flux;
+        }
+        _hops++;
+        copy(_count.begin(), _count.end(), frame.onsetCount.begin());
+        copy(_time.begin(), _time.end(), frame.onsetTime.begin());
+    }
+
+private:
+    float median(const float* values, int n) {
+        copy(values, values + n, _scratch.begin());
+        nth_element(_scratch.begin(), _scratch.begin() + n / 2, _scratch.begin() + n);
+        return _scratch[n / 2];
+    }
+
+    AnalysisConfig _config;
+    int _nBands = 1;
+    int _nValues = 0;
+    int _history = 3;
+    uint64_t _hops = 0;
+    vector<float> _last;            // log value of every bin at the last hop
+    vector<float> _flux;            // _history hops per band
+    vector<float> _previousFlux;
+    vector<float> _scratch;
+    vector<uint32_t> _count;
+    vector<double> _time;
+};
+
+// One state's view of the onsets, which bands fired since it last looked
+class OnsetReader {
+public:
+    // With the frame the state is about to use. A restarted analysis fires nothing.
+    void update(const AnalysisFrame& frame) {
+        int n = frame.onsetCount.size();
+        bool restarted = (frame.sequence < _sequence || _seen.size() != n);
+        _fired.assign(n, false);
+        if (!restarted) {
+            for (int b = 0; b < n; b++) {
+                _fired[b] = (frame.onsetCount[b] != _seen[b]);
+            }
+        }
+        _seen = frame.onsetCount;
+        _sequence = frame.sequence;
+    }
+
+    bool fired(int band) const {
+        return band >= 0 && band < _fired.size() && _fired[band];
+    }
+
+    // Whether the band holding values first .. first + count had an onset, by the middle value
+    bool fired(int first, int count, int nValues) const {
+        if (_fired.empty()) {
+            return false;
+        }
+        return fired(OnsetDetector::bandOf(first + count / 2, nValues, _fired.size()));
+    }
+
+private:
+    vector<uint32_t> _seen;
+    vector<bool> _fired;
+    uint64_t _sequence = 0;
+};
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Wall time spent in each phase of a frame, summed over every thread.
+//
+// The code of a phase opens a Scope; collect() hands back what each phase
+// took since the last call. Work on the analysis thread or on workers adds
+// up like work on the render thread, so Geometry is the CPU cost of all of
+// its jobs, not how long the render thread waited for them. Phases can
+// nest: Tessellation inside a geometry job is also part of Geometry. Off by
+// default, and a closed Scope then costs one relaxed load.
+//
+// With tracing on, every Scope is also kept as an event, with its thread,
+// in a ring of the last TRACE_CAPACITY events. A Scope with only a name is
+// a span in the trace that counts toward no phase. saveTrace() writes the
+// ring in the Chrome trace format, for chrome://tracing or Perfetto. Names
+// are kept as pointers, so they have to be string literals.
+class PhaseTimer {
+public:
+    enum Phase {
+        Analysis,
+        Geometry,
+        Tessellation,
+        Physics,
+        Draw,
+        Post,
+        PHASE_COUNT
+    };
+
+    class Scope {
+    public:
+        explicit Scope(Phase phase, const char* name = NULL)
+            : _phase(phase), _name(name != NULL ? name : getName(phase)), _start(isEnabled() ? now() : 0) {
+        }
+
+        explicit Scope(const char* name) : _phase(PHASE_COUNT), _name(name), _start(isEnabled() ? now() : 0) {
+        }
+
+        ~Scope() {
+            if (_start == 0) {
+                return;
+            }
+            uint64_t duration = now() - _start;
+            if (_phase != PHASE_COUNT) {
+                add(_phase, duration);
+            }
+            if (isTracing()) {
+                record(_name, _start, duration, 0, false);
+            }
+        }
+
+    private:
+        Scope(const Scope&);
+        Scope& operator=(const Scope&);
+
+        Phase _phase;
+        const char* _name;
+        uint64_t _start;
+    };
+
+    static const int TRACE_CAPACITY = 1 << 16;
+
+    static bool isEnabled() {
+        return enabled().load(memory_order_relaxed);
+    }
+
+    static void setEnabled(bool enabled) {
+        PhaseTimer::enabled() = enabled;
+    }
+
+    static bool isTracing() {
+        return trace().on.load(memory_order_relaxed);
+    }
+
+    // keeps events from now on, forgets the ones before when turned off
+    static void setTracing(bool tracing) {
+        Trace& t = trace();
+        lock_guard<mutex> lock(t.guard);
+        t.events.assign(tracing ? TRACE_CAPACITY : 0, Event());
+        t.next = 0;
+        t.on = tracing;
+    }
+
+    // a value over time in the trace, e.g. the GPU time of each frame
+    static void counter(const char* name, double value) {
+        if (isTracing()) {
+            record(name, now(), 0, value, true);
+        }
+    }
+
+    static void add(Phase phase, uint64_t nanoseconds) {
+        totals()[phase].fetch_add(nanoseconds, memory_order_relaxed);
+    }
+
+    // milliseconds per phase since the last call
+    static void collect(double ms[PHASE_COUNT]) {
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            ms[i] = totals()[i].exchange(0) / 1e6;
+        }
+    }
+
+    static const char* getName(Phase phase) {
+        static const char* names[PHASE_COUNT] = {"analysis", "geometry", "tessellation", "physics", "draw", "post"};
+        return names[phase];
+    }
+
+    static uint64_t now() {
+        return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // the ring as Chrome trace JSON, oldest event first
+    static bool saveTrace(string path) {
+        vector<Event> events;
+        {
+            Trace& t = trace();
+            lock_guard<mutex> lock(t.guard);
+            size_t n = MIN(t.next, t.events.size());
+            for (size_t i = t.next - n; i < t.next; i++) {
+                events.push_back(t.events[i % t.events.size()]);
+            }
+        }
+        ofstream out(ofToDataPath(path, true).c_str());
+        if (!out) {
+            ofLogError("PhaseTimer") << "could not write " << path;
+            return false;
+        }
+        uint64_t origin = UINT64_MAX;
+        for (int i = 0; i < events.size(); i++) {
+            origin = MIN(origin, events[i].start);
+        }
+        // the thread that saves is the render thread
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << threadId() << ",\"args\":{\"name\":\"render\"}}";
+        out << fixed << setprecision(3);
+        for (int i = 0; i < events.size(); i++) {
+            const Event& e = events[i];
+            out << ",\n{\"name\":\"" << e.name << "\",\"pid\":1,\"tid\":" << e.thread
+                << ",\"ts\":" << (e.start - origin) / 1e3;
+            if (e.counter) {
+                out << ",\"ph\":\"C\",\"args\":{\"ms\":" << e.value << "}}";
+            } else {
+                out << ",\"ph\":\"X\",\"dur\":" << e.duration / 1e3 << "}";
+            }
+        }
+        out << "\n]}\n";
+        return static_cast<bool>(out);
+    }
+
+private:
+    struct Event {
+        const char* name = "";
+        uint64_t start = 0;
+        uint64_t duration = 0;
+        double value = 0;
+        size_t thread = 0;
+        bool counter = false;
+    };
+
+    struct Trace {
+        atomic<bool> on;
+        mutex guard;
+        vector<Event> events;
+        size_t next = 0;    // events ever recorded, the ring index is next % capacity
+
+        Trace() : on(false) {
+        }
+    };
+
+    static void record(const char* name, uint64_t start, uint64_t duration, double value, bool counter) {
+        Trace& t = trace();
+        lock_guard<mutex> lock(t.guard);
+        if (t.events.empty()) {
+            return;
+        }
+        Event& e = t.events[t.next % t.events.size()];
+        e.name = name;
+        e.start = start;
+        e.duration = duration;
+        e.value = value;
+        e.thread = threadId();
+        e.counter = counter;
+        t.next++;
+    }
+
+    // small enough to stay exact as a JSON number
+    static size_t threadId() {
+        return hash<thread::id>()(this_thread::get_id()) & 0xfffffff;
+    }
+
+    // function statics, this header is included from more than one .cpp
+    static atomic<bool>& enabled() {
+        static atomic<bool> e(false);
+        return e;
+    }
+
+    static atomic<uint64_t>* totals() {
+        static atomic<uint64_t> t[PHASE_COUNT];
+        return t;
+    }
+
+    static Trace& trace() {
+        static Trace t;
+        return t;
+    }
+};
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxPostProcessing.h"
+#include "PhaseTimer.h"
+#include "GpuTimer.h"
+
+// The one post-processing chain every state draws through, FXAA then bloom.
+//
+// ofApp owns it in SharedData. States switch passes on or off, which never
+// reallocates anything. The framebuffers follow the window lazily: resize()
+// only records the new size, and the next begin() rebuilds the chain at that
+// size times the render scale. Below 1 the chain renders smaller and end()
+// stretches the result over the window.
+class PostChain {
+public:
+    enum Pass {
+        Fxaa,
+        Bloom,
+        PASS_COUNT
+    };
+
+    void setup(int width, int height, float renderScale = 1.0) {
+        _width = width;
+        _height = height;
+        _renderScale = renderScale;
+        for (int i = 0; i < PASS_COUNT; i++) {
+            _enabled[i] = true;
+        }
+        allocate();
+    }
+
+    void resize(int width, int height) {
+        _width = width;
+        _height = height;
+    }
+
+    void setRenderScale(float scale) {
+        _renderScale = ofClamp(scale, 0.25, 1.0);
+    }
+
+    float getRenderScale() const {
+        return _renderScale;
+    }
+
+    void setEnabled(Pass pass, bool enabled) {
+        _enabled[pass] = enabled;
+        if (pass == Fxaa && _fxaa) {
+            _fxaa->setEnabled(enabled);
+        } else if (pass == Bloom && _bloom) {
+            _bloom->setEnabled(enabled);
+        }
+    }
+
+    bool isEnabled(Pass pass) const {
+        return _enabled[pass];
+    }
+
+    void begin() {
+        PhaseTimer::Scope scope(PhaseTimer::Post, "post.begin");
+        allocate();
+        _post->begin();
+    }
+
+    void begin(ofCamera& camera) {
+        PhaseTimer::Scope scope(PhaseTimer::Post, "post.begin");
+        allocate();
+        _post->begin(camera);
+    }
+
+    void end() {
+        PhaseTimer::Scope scope(PhaseTimer::Post, "post.end");
+        GpuTimer::Scope gpu(PhaseTimer::Post);
+        if (_postWidth == _width && _postHeight == _height) {
+            _post->end();
+        } else {
+            _post->end(false);
+            _post->draw(0, 0, _width, _height);
+        }
+    }
+
+private:
+    // rebuilds the chain when the window or the render scale changed since the last frame
+    void allocate() {
+        int width = MAX(1, static_cast<int>(_width * _renderScale));
+        int height = MAX(1, static_cast<int>(_height * _renderScale));
+        if (_post && _postWidth == width && _postHeight == height) {
+            return;
+        }
+        _postWidth = width;
+        _postHeight = height;
+        // passes take their size when they are created, so they go too
+        _post.reset(new ofxPostProcessing());
+        _post->init(width, height);
+        _fxaa = _post->createPass<FxaaPass>();
+        _bloom = _post->createPass<BloomPass>();
+        _fxaa->setEnabled(_enabled[Fxaa]);
+        _bloom->setEnabled(_enabled[Bloom]);
+    }
+
+    int _width = 0;
+    int _height = 0;
+    float _renderScale = 1.0;
+    int _postWidth = 0;
+    int _postHeight = 0;
+    bool _enabled[PASS_COUNT];
+    unique_ptr<ofxPostProcessing> _post;
+    FxaaPass::Ptr _fxaa;
+    BloomPass::Ptr _bloom;
+};
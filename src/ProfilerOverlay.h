@@ -0,0 +1,122 @@
+#pragma once
+
+#include "ofMain.h"
+#include "PhaseTimer.h"
+#include "GpuTimer.h"
+
+// Rolling graphs of the frame time and of every phase, CPU and GPU.
+//
+// Turning it on turns on PhaseTimer timing and tracing, and it shows
+// whenever timing is on. Each frame ofApp hands it the phase times once the
+// frame is drawn; it keeps the last HISTORY frames and draws them over the
+// window, against a scale of two 60 fps frames with the one-frame budget
+// marked. The CPU draw row is
+// submission without the post-processing inside it, as in the benchmark.
+class ProfilerOverlay {
+public:
+    static const int HISTORY = 240;
+
+    ProfilerOverlay() {
+        for (int i = 0; i < ROW_COUNT; i++) {
+            _rows[i].assign(HISTORY, 0);
+        }
+    }
+
+    void setEnabled(bool enabled) {
+        PhaseTimer::setEnabled(enabled);
+        PhaseTimer::setTracing(enabled);
+        for (int i = 0; i < ROW_COUNT; i++) {
+            _rows[i].assign(HISTORY, 0);
+        }
+        _next = 0;
+    }
+
+    bool isEnabled() const {
+        return PhaseTimer::isEnabled();
+    }
+
+    void update(double frameMs) {
+        if (!isEnabled()) {
+            return;
+        }
+        double cpu[PhaseTimer::PHASE_COUNT];
+        double gpu[PhaseTimer::PHASE_COUNT];
+        PhaseTimer::collect(cpu);
+        GpuTimer::collect(gpu);
+        cpu[PhaseTimer::Draw] = MAX(0.0, cpu[PhaseTimer::Draw] - cpu[PhaseTimer::Post]);
+        int slot = _next % HISTORY;
+        _rows[Frame][slot] = frameMs;
+        for (int p = 0; p < PhaseTimer::PHASE_COUNT; p++) {
+            _rows[1 + p][slot] = cpu[p];
+        }
+        _rows[GpuDraw][slot] = gpu[PhaseTimer::Draw];
+        _rows[GpuPost][slot] = gpu[PhaseTimer::Post];
+        _next++;
+
+        PhaseTimer::counter("frame", frameMs);
+        PhaseTimer::counter("gpu draw", gpu[PhaseTimer::Draw]);
+        PhaseTimer::counter("gpu post", gpu[PhaseTimer::Post]);
+    }
+
+    void draw(float x, float y) {
+        if (!isEnabled()) {
+            return;
+        }
+        const float width = HISTORY;
+        const float height = 24;
+        const float scaleMs = 2000.0 / 60.0;
+        ofPushStyle();
+        ofFill();
+        ofSetColor(0, 180);
+        ofDrawRectangle(x, y, width + 370, ROW_COUNT * (height + 6) + 6);
+
+        int n = MIN(_next, HISTORY);
+        for (int r = 0; r < ROW_COUNT; r++) {
+            float top = y + 6 + r * (height + 6);
+            float budget = top + height * (1.0 - 1000.0 / 60.0 / scaleMs);
+            ofSetColor(255, 60);
+            ofDrawLine(x + 6, budget, x + 6 + width, budget);
+
+            // oldest on the left
+            double sum = 0, peak = 0;
+            _graph.clear();
+            for (int i = 0; i < n; i++) {
+                double ms = _rows[r][(_next - n + i) % HISTORY];
+                sum += ms;
+                peak = MAX(peak, ms);
+                _graph.addVertex(x + 6 + width - n + i, top + height * (1.0 - MIN(ms, scaleMs) / scaleMs));
+            }
+            ofSetColor(peak > 1000.0 / 60.0 ? ofColor(255, 80, 80) : ofColor(120, 255, 120));
+            _graph.draw();
+
+            double last = (n > 0 ? _rows[r][(_next - 1) % HISTORY] : 0);
+            ofSetColor(255);
+            ofDrawBitmapString(string(getRowName(r)) + " " + ofToString(last, 2) + " avg " + ofToString(n > 0 ? sum / n : 0, 2)
+                               + " max " + ofToString(peak, 2) + " ms", x + width + 14, top + height * 0.5 + 4);
+        }
+        ofPopStyle();
+    }
+
+private:
+    enum Row {
+        Frame,
+        GpuDraw = 1 + PhaseTimer::PHASE_COUNT,
+        GpuPost,
+        ROW_COUNT
+    };
+
+    static const char* getRowName(int row) {
+        if (row == Frame) {
+            return "frame";
+        } else if (row == GpuDraw) {
+            return "gpu draw";
+        } else if (row == GpuPost) {
+            return "gpu post";
+        }
+        return PhaseTimer::getName(static_cast<PhaseTimer::Phase>(row - 1));
+    }
+
+    vector<double> _rows[ROW_COUNT];
+    int _next = 0;
+    ofPolyline _graph;
+};
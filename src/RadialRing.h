@@ -0,0 +1,95 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Closed ring whose radius at each point is pushed out by a displacement value.
+//
+// Every point lies on its own fixed direction from the centre, so the outline
+// is always star-shaped around it and a triangle fan from the centre fills it
+// exactly. The fan indices and the unit-circle directions are built once, and
+// update() is a single pass writing rim vertices into a persistent vbo. The
+// pass can also run off the render thread: compute() only fills a vertex
+// array, and upload() sends it to the vbo afterwards.
+class RadialRing {
+public:
+    void setup(int nPoints, float radius) {
+        _nPoints = nPoints;
+        _radius = radius;
+        _directions = &unitCircle(nPoints);
+        _vertices.assign(nPoints + 1, ofVec3f());
+
+        // centre first, then the rim
+        vector<ofIndexType> indices;
+        for (int i = 0; i < nPoints; i++) {
+            indices.push_back(0);
+            indices.push_back(1 + i);
+            indices.push_back(1 + (i + 1) % nPoints);
+        }
+        update(NULL, 0, 0);
+        _vbo.setVertexData(_vertices.data(), _vertices.size(), GL_DYNAMIC_DRAW);
+        _vbo.setIndexData(indices.data(), indices.size(), GL_STATIC_DRAW);
+    }
+
+    // Rim point j sits at radius + displacement[j] * gain. Points past n are undisplaced.
+    void update(const float* displacement, int n, float gain) {
+        compute(displacement, n, gain, _vertices);
+        upload(_vertices);
+    }
+
+    // update() without the upload, into vertices. Touches no GL and no ring state, so any thread can run it.
+    void compute(const float* displacement, int n, float gain, vector<ofVec3f>& vertices) const {
+        const vector<ofVec2f>& directions = *_directions;
+        vertices.resize(_nPoints + 1);
+        vertices[0].set(0, 0, 0);
+        n = MIN(n, _nPoints);
+        for (int j = 0; j < n; j++) {
+            float r = _radius + displacement[j] * gain;
+            vertices[1 + j].set(directions[j].x * r, directions[j].y * r, 0);
+        }
+        for (int j = n; j < _nPoints; j++) {
+            vertices[1 + j].set(directions[j].x * _radius, directions[j].y * _radius, 0);
+        }
+    }
+
+    // render thread only
+    void upload(const vector<ofVec3f>& vertices) {
+        if (_vbo.getIsAllocated() && vertices.size() == _nPoints + 1) {
+            _vbo.updateVertexData(vertices.data(), vertices.size());
+        }
+    }
+
+    int getNumPoints() const {
+        return _nPoints;
+    }
+
+    void drawFill() const {
+        _vbo.drawElements(GL_TRIANGLES, _nPoints * 3);
+    }
+
+    void drawOutline() const {
+        _vbo.draw(GL_LINE_LOOP, 1, _nPoints);
+    }
+
+    // cos/sin of nPoints evenly spaced angles, shared by every ring of that size
+    static const vector<ofVec2f>& unitCircle(int nPoints) {
+        static map<int, vector<ofVec2f>> tables;
+        static mutex tablesMutex;
+        lock_guard<mutex> lock(tablesMutex);
+        vector<ofVec2f>& table = tables[nPoints];
+        if (table.empty()) {
+            table.resize(nPoints);
+            for (int j = 0; j < nPoints; j++) {
+                float rad = TWO_PI / nPoints * j;
+                table[j].set(cos(rad), sin(rad));
+            }
+        }
+        return table;
+    }
+
+private:
+    int _nPoints = 0;
+    float _radius = 0;
+    const vector<ofVec2f>* _directions = NULL;
+    vector<ofVec3f> _vertices;
+    ofVbo _vbo;
+};
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "ofMain.h"
+
+// A value moving linearly from one number to another, timed on Clock
+// milliseconds so an offline render or a follower fades exactly as live does.
+// Before start() it holds its initial value; with a zero duration it jumps.
+class Ramp {
+public:
+    explicit Ramp(float value = 0) : _from(value), _to(value) {
+    }
+
+    void start(float from, float to, uint64_t now, uint64_t durationMs) {
+        _from = from;
+        _to = to;
+        _start = now;
+        _duration = durationMs;
+    }
+
+    float get(uint64_t now) const {
+        if (_duration == 0 || now >= _start + _duration) {
+            return _to;
+        }
+        float t = static_cast<float>(now - MIN(now, _start)) / _duration;
+        return _from + (_to - _from) * t;
+    }
+
+private:
+    float _from;
+    float _to;
+    uint64_t _start = 0;
+    uint64_t _duration = 0;
+};
@@ -0,0 +1,376 @@
+#pragma once
+
+#include "ofMain.h"
+#include "AnalysisConfig.h"
+#include "AnalysisFrame.h"
+#include "WorkerPool.h"
+#include "ChunkRing.h"
+
+// Always-on black box of the last few seconds, for glitches that only happen live.
+//
+// Keeps, in rings allocated once by setup():
+// - the mono input the analysis consumed;
+// - one record per render frame: the clock, the frame time, how much audio
+//   had been analysed, and the analysis frame the states were handed;
+// - the last MAX_EVENTS keys and state changes, so a replay can rebuild the
+//   state and mode the recording starts in.
+// save() holds the chunks of the audio and frame rings, which takes the
+// audio lock for as long as copying a few dozen pointers, and copies and
+// writes them on a worker. It runs on a key, or by itself when a frame takes
+// longer than the glitch threshold. Replay plays the file back. Audio comes
+// from the analysis thread, everything else from the render thread.
+class Recorder {
+public:
+    enum EventType {
+        Key,
+        State
+    };
+
+    struct Event {
+        uint64_t frame;     // applied before this frame's update
+        int32_t type;
+        int32_t value;
+    };
+
+    struct Frame {
+        uint64_t number = 0;
+        double clock = 0;
+        float frameMs = 0;
+        uint64_t audioPosition = 0;     // samples analysed before this frame
+        uint64_t sequence = 0;          // of the analysis frame, 0 when there was none yet
+        double time = 0;
+        float rms = 0;
+        float smoothedVolume = 0;
+        float scaledVolume = 0;
+    };
+
+    // A saved file, whole in memory
+    struct Recording {
+        AnalysisConfig config;
+        int width = 0;
+        int height = 0;
+        uint64_t firstAudioSample = 0;
+        vector<float> audio;
+        vector<Frame> frames;
+        vector<float> bins;         // config.bandCount per frame
+        vector<uint32_t> onsetCounts;   // config.onsetBands per frame
+        vector<double> onsetTimes;
+        vector<Event> events;
+
+        bool load(string filename);
+    };
+
+    static const int MAX_EVENTS = 1 << 16;
+
+    ~Recorder() {
+        if (_writing.valid()) {
+            _writing.wait();
+        }
+    }
+
+    // seconds of history, assuming at most maxFps render frames a second
+    void setup(const AnalysisConfig& config, float seconds, float glitchMs, int maxFps = 120) {
+        _config = config;
+        _config.validate();
+        _glitchMs = glitchMs;
+        _audio.setup(static_cast<size_t>(seconds * config.sampleRate), AUDIO_CHUNK);
+        _hopSize = 0;
+        _hopStart = 0;
+        size_t nFrames = static_cast<size_t>(seconds * maxFps);
+        _frames.setup(nFrames, FRAME_CHUNK);
+        _bins.setup(nFrames * _config.bandCount, FRAME_CHUNK * _config.bandCount);
+        _onsetCounts.setup(nFrames * _config.onsetBands, FRAME_CHUNK * _config.onsetBands);
+        _onsetTimes.setup(nFrames * _config.onsetBands, FRAME_CHUNK * _config.onsetBands);
+        _frameBins.assign(_config.bandCount, 0);
+        _frameOnsetCounts.assign(_config.onsetBands, 0);
+        _frameOnsetTimes.assign(_config.onsetBands, 0);
+        _events.assign(MAX_EVENTS, Event());
+        _eventTotal = 0;
+        _lastSave = -1e9;
+    }
+
+    bool isEnabled() const {
+        return !_frames.empty();
+    }
+
+    // analysis thread, one hop at a time
+    void addAudio(const float* samples, int n) {
+        if (_audio.empty()) {
+            return;
+        }
+        lock_guard<mutex> lock(_audioMutex);
+        if (n != _hopSize) {
+            _hopSize = n;
+            _hopStart = _audio.getTotal();
+        }
+        _audio.push(samples, n);
+    }
+
+    // Once per update, before the states run. Saves when the last frame took longer than the glitch threshold.
+    void addFrame(double clock, float frameMs, const AnalysisFrame* analysis) {
+        if (!isEnabled()) {
+            return;
+        }
+        Frame f;
+        f.number = _frames.getTotal();
+        f.clock = clock;
+        f.frameMs = frameMs;
+        {
+            lock_guard<mutex> lock(_audioMutex);
+            f.audioPosition = _audio.getTotal();
+        }
+        float* bins = _frameBins.data();
+        uint32_t* onsetCounts = _frameOnsetCounts.data();
+        double* onsetTimes = _frameOnsetTimes.data();
+        fill(bins, bins + _config.bandCount, 0.0f);
+        fill(onsetCounts, onsetCounts + _config.onsetBands, 0);
+        fill(onsetTimes, onsetTimes + _config.onsetBands, 0.0);
+        if (analysis != NULL) {
+            f.sequence = analysis->sequence;
+            f.time = analysis->time;
+            f.rms = analysis->rms;
+            f.smoothedVolume = analysis->smoothedVolume;
+            f.scaledVolume = analysis->scaledVolume;
+            copy(analysis->bins.begin(), analysis->bins.begin() + MIN(analysis->bins.size(), static_cast<size_t>(_config.bandCount)), bins);
+            int nOnsets = MIN(analysis->onsetCount.size(), static_cast<size_t>(_config.onsetBands));
+            copy(analysis->onsetCount.begin(), analysis->onsetCount.begin() + nOnsets, onsetCounts);
+            copy(analysis->onsetTime.begin(), analysis->onsetTime.begin() + nOnsets, onsetTimes);
+        }
+        _frames.push(&f, 1);
+        _bins.push(bins, _config.bandCount);
+        _onsetCounts.push(onsetCounts, _config.onsetBands);
+        _onsetTimes.push(onsetTimes, _config.onsetBands);
+
+        // startup and the save itself are slow frames too
+        bool warm = _frames.getTotal() > WARMUP_FRAMES && clock - _lastSave > GLITCH_COOLDOWN;
+        if (_glitchMs > 0 && frameMs > _glitchMs && warm) {
+            ofLogWarning("Recorder") << "frame " << f.number << " took " << frameMs << " ms";
+            save("glitch-" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".mrec", clock);
+        }
+    }
+
+    void addKey(int key) {
+        addEvent(Key, key);
+    }
+
+    void addState(int state) {
+        addEvent(State, state);
+    }
+
+    // Holds the history, then copies and writes it on a worker. False if the last save is still being written.
+    bool save(string filename, double clock) {
+        if (!isEnabled()) {
+            return false;
+        }
+        if (_writing.valid() && _writing.wait_for(chrono::seconds(0)) != future_status::ready) {
+            ofLogWarning("Recorder") << "still writing the last recording";
+            return false;
+        }
+        _lastSave = clock;
+        shared_ptr<Snapshot> snapshot(new Snapshot());
+        hold(*snapshot);
+        string path = ofToDataPath(filename, true);
+        _writing = WorkerPool::shared().submit([snapshot, path]() {
+            Recording& recording = snapshot->recording;
+            snapshot->audio.read(recording.audio);
+            snapshot->frames.read(recording.frames);
+            snapshot->bins.read(recording.bins);
+            snapshot->onsetCounts.read(recording.onsetCounts);
+            snapshot->onsetTimes.read(recording.onsetTimes);
+            bool saved = write(recording, path);
+            if (saved) {
+                ofLogNotice("Recorder") << "saved " << recording.frames.size() << " frames to " << path;
+            } else {
+                ofLogError("Recorder") << "could not write " << path;
+            }
+            return saved;
+        });
+        return true;
+    }
+
+private:
+    static const uint32_t VERSION = 2;
+    static const int WARMUP_FRAMES = 120;
+    static const int GLITCH_COOLDOWN = 10;     // seconds
+    static const int AUDIO_CHUNK = 1 << 14;     // samples
+    static const int FRAME_CHUNK = 64;          // frames
+
+    // what save() hands to the worker
+    struct Snapshot {
+        Recording recording;    // all but the rings
+        ChunkRing<float>::Range audio;
+        ChunkRing<Frame>::Range frames;
+        ChunkRing<float>::Range bins;
+        ChunkRing<uint32_t>::Range onsetCounts;
+        ChunkRing<double>::Range onsetTimes;
+    };
+
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        int32_t fftSize, hopSize, window, bandCount, minBin, logBands, sampleRate, audioBufferSize;
+        float minFrequency, maxFrequency;
+        int32_t onsetBands;
+        float onsetWindow, onsetThreshold, onsetDelta, onsetInterval;
+        int32_t width, height;
+        uint64_t firstAudioSample;
+        uint64_t nAudio, nFrames, nEvents;
+    };
+
+    void addEvent(EventType type, int value) {
+        if (!isEnabled()) {
+            return;
+        }
+        // past MAX_EVENTS a replay starts from the wrong state, but the recording still shows what happened
+        Event& e = _events[_eventTotal % MAX_EVENTS];
+        e.frame = _frames.getTotal();
+        e.type = type;
+        e.value = value;
+        _eventTotal++;
+    }
+
+    // Render thread. Copies the events and holds the rest for the worker.
+    void hold(Snapshot& snapshot) {
+        Recording& r = snapshot.recording;
+        r.config = _config;
+        r.width = ofGetWidth();
+        r.height = ofGetHeight();
+        uint64_t first = _frames.getOldest();
+        uint64_t last = _frames.getTotal();
+        snapshot.frames = _frames.hold(first, last);
+        snapshot.bins = _bins.hold(first * _config.bandCount, last * _config.bandCount);
+        snapshot.onsetCounts = _onsetCounts.hold(first * _config.onsetBands, last * _config.onsetBands);
+        snapshot.onsetTimes = _onsetTimes.hold(first * _config.onsetBands, last * _config.onsetBands);
+        uint64_t nEvents = MIN(_eventTotal, static_cast<uint64_t>(MAX_EVENTS));
+        r.events.resize(nEvents);
+        for (uint64_t i = 0; i < nEvents; i++) {
+            r.events[i] = _events[(_eventTotal - nEvents + i) % MAX_EVENTS];
+        }
+
+        lock_guard<mutex> lock(_audioMutex);
+        // from the start of a hop, so a reanalysis windows the audio as the live one did
+        uint64_t firstSample = _audio.getOldest();
+        if (_hopSize > 0 && firstSample > _hopStart) {
+            firstSample = _hopStart + (firstSample - _hopStart + _hopSize - 1) / _hopSize * _hopSize;
+        }
+        firstSample = MIN(firstSample, _audio.getTotal());
+        r.firstAudioSample = firstSample;
+        snapshot.audio = _audio.hold(firstSample, _audio.getTotal());
+    }
+
+    static bool write(const Recording& r, string path) {
+        Header header;
+        memcpy(header.magic, "MREC", 4);
+        header.version = VERSION;
+        header.fftSize = r.config.fftSize;
+        header.hopSize = r.config.hopSize;
+        header.window = r.config.window;
+        header.bandCount = r.config.bandCount;
+        header.minBin = r.config.minBin;
+        header.logBands = r.config.logBands;
+        header.sampleRate = r.config.sampleRate;
+        header.audioBufferSize = r.config.audioBufferSize;
+        header.minFrequency = r.config.minFrequency;
+        header.maxFrequency = r.config.maxFrequency;
+        header.onsetBands = r.config.onsetBands;
+        header.onsetWindow = r.config.onsetWindow;
+        header.onsetThreshold = r.config.onsetThreshold;
+        header.onsetDelta = r.config.onsetDelta;
+        header.onsetInterval = r.config.onsetInterval;
+        header.width = r.width;
+        header.height = r.height;
+        header.firstAudioSample = r.firstAudioSample;
+        header.nAudio = r.audio.size();
+        header.nFrames = r.frames.size();
+        header.nEvents = r.events.size();
+
+        string tmp = path + ".tmp";
+        ofstream out(tmp.c_str(), ios::binary | ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(r.audio.data()), sizeof(float) * r.audio.size());
+        out.write(reinterpret_cast<const char*>(r.frames.data()), sizeof(Frame) * r.frames.size());
+        out.write(reinterpret_cast<const char*>(r.bins.data()), sizeof(float) * r.bins.size());
+        out.write(reinterpret_cast<const char*>(r.onsetCounts.data()), sizeof(uint32_t) * r.onsetCounts.size());
+        out.write(reinterpret_cast<const char*>(r.onsetTimes.data()), sizeof(double) * r.onsetTimes.size());
+        out.write(reinterpret_cast<const char*>(r.events.data()), sizeof(Event) * r.events.size());
+        out.close();
+        if (!out) {
+            remove(tmp.c_str());
+            return false;
+        }
+        return rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    AnalysisConfig _config;
+    float _glitchMs = 0;
+    double _lastSave = 0;
+
+    mutex _audioMutex;
+    ChunkRing<float> _audio;
+    int _hopSize = 0;
+    uint64_t _hopStart = 0;     // where the hops of _hopSize began
+
+    ChunkRing<Frame> _frames;
+    ChunkRing<float> _bins;
+    ChunkRing<uint32_t> _onsetCounts;
+    ChunkRing<double> _onsetTimes;
+    vector<float> _frameBins;   // the frame being added
+    vector<uint32_t> _frameOnsetCounts;
+    vector<double> _frameOnsetTimes;
+    vector<Event> _events;      // ring of MAX_EVENTS
+    uint64_t _eventTotal = 0;
+
+    future<bool> _writing;
+};
+
+inline bool Recorder::Recording::load(string filename) {
+    ifstream in(ofToDataPath(filename, true).c_str(), ios::binary);
+    Header header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return false;
+    }
+    if (memcmp(header.magic, "MREC", 4) != 0 || header.version != VERSION) {
+        return false;
+    }
+    // sizes far beyond any setup() are a damaged file, not an allocation to attempt
+    const uint64_t limit = 1ull << 28;
+    if (header.bandCount <= 0 || header.sampleRate <= 0 || header.onsetBands <= 0 || header.onsetBands > header.bandCount
+        || header.nAudio > limit || header.nFrames > limit / header.bandCount || header.nEvents > MAX_EVENTS) {
+        return false;
+    }
+    config.fftSize = header.fftSize;
+    config.hopSize = header.hopSize;
+    config.window = static_cast<fftWindowType>(header.window);
+    config.bandCount = header.bandCount;
+    config.minBin = header.minBin;
+    config.logBands = header.logBands;
+    config.sampleRate = header.sampleRate;
+    config.audioBufferSize = header.audioBufferSize;
+    config.minFrequency = header.minFrequency;
+    config.maxFrequency = header.maxFrequency;
+    config.onsetBands = header.onsetBands;
+    config.onsetWindow = header.onsetWindow;
+    config.onsetThreshold = header.onsetThreshold;
+    config.onsetDelta = header.onsetDelta;
+    config.onsetInterval = header.onsetInterval;
+    config.validate();
+    width = header.width;
+    height = header.height;
+    firstAudioSample = header.firstAudioSample;
+    audio.resize(header.nAudio);
+    frames.resize(header.nFrames);
+    bins.resize(header.nFrames * header.bandCount);
+    onsetCounts.resize(header.nFrames * header.onsetBands);
+    onsetTimes.resize(header.nFrames * header.onsetBands);
+    events.resize(header.nEvents);
+    in.read(reinterpret_cast<char*>(audio.data()), sizeof(float) * audio.size());
+    in.read(reinterpret_cast<char*>(frames.data()), sizeof(Frame) * frames.size());
+    in.read(reinterpret_cast<char*>(bins.data()), sizeof(float) * bins.size());
+    in.read(reinterpret_cast<char*>(onsetCounts.data()), sizeof(uint32_t) * onsetCounts.size());
+    in.read(reinterpret_cast<char*>(onsetTimes.data()), sizeof(double) * onsetTimes.size());
+    in.read(reinterpret_cast<char*>(events.data()), sizeof(Event) * events.size());
+    return static_cast<bool>(in);
+}
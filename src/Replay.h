@@ -0,0 +1,153 @@
+#pragma once
+
+#include "ofMain.h"
+#include "AudioAnalyzer.h"
+#include "Recorder.h"
+#include "Clock.h"
+
+// Plays a Recorder file back, run as:
+//
+//   mophV --replay glitch.mrec [--reanalyze]
+//
+// Each app frame replays one recorded frame: Clock is set to the recorded
+// time, the analyzer publishes the recorded analysis frame, and ofApp applies
+// the keys that came in before that frame. The keys from before the first
+// recorded frame are applied at once, which brings back the state and mode.
+// With --reanalyze the recorded audio goes through the analysis again
+// instead, up to the position each frame had, to try analysis changes on the
+// input that caused the glitch. A replay starts from a fixed ofRandom seed,
+// so it gives the same frames every time, but not bit for bit the frames of
+// the show, whose random state is lost.
+class Replay {
+public:
+    struct Settings {
+        string file;
+        bool reanalyze = false;
+
+        bool isEnabled() const {
+            return !file.empty();
+        }
+
+        // argv[1] is --replay
+        bool parse(int argc, char* argv[]) {
+            for (int i = 2; i < argc; i++) {
+                string arg = argv[i];
+                if (arg == "--reanalyze") {
+                    reanalyze = true;
+                } else if (file.empty() && arg.compare(0, 2, "--") != 0) {
+                    file = arg;
+                } else {
+                    cerr << "unknown argument " << arg << endl;
+                    return false;
+                }
+            }
+            if (file.empty()) {
+                cerr << "usage: mophV --replay file.mrec [--reanalyze]" << endl;
+                return false;
+            }
+            return true;
+        }
+    };
+
+    void setSettings(const Settings& settings) {
+        _settings = settings;
+    }
+
+    bool isEnabled() const {
+        return _settings.isEnabled();
+    }
+
+    // Loads the file and starts the analyzer without a device at the recorded settings,
+    // in a window of the recorded size. False if the file is unusable.
+    bool setup(AudioAnalyzer& analyzer) {
+        if (!_recording.load(_settings.file) || _recording.frames.empty()) {
+            ofLogError("Replay") << "could not read " << _settings.file;
+            _recording.frames.clear();
+            _status = 1;
+            return false;
+        }
+        ofLogNotice("Replay") << _recording.frames.size() << " frames, " << _recording.audio.size() << " samples, "
+                              << _recording.events.size() << " events from " << _settings.file;
+        ofSetWindowShape(_recording.width, _recording.height);
+        analyzer.setupOffline(_recording.config);
+        _analyzer = &analyzer;
+        _frame = 0;
+        _event = 0;
+        _audio = 0;
+        _analysis.bins.assign(_recording.config.bandCount, 0);
+        _analysis.onsetCount.assign(_recording.config.onsetBands, 0);
+        _analysis.onsetTime.assign(_recording.config.onsetBands, 0);
+        ofSeedRandom(0);
+        Clock::setFixed(_recording.frames[0].clock);
+        return true;
+    }
+
+    // the events recorded before the first frame
+    void takeEarlierEvents(vector<Recorder::Event>& events) {
+        events.clear();
+        uint64_t first = _recording.frames[0].number;
+        while (_event < _recording.events.size() && _recording.events[_event].frame < first) {
+            events.push_back(_recording.events[_event++]);
+        }
+    }
+
+    // Moves to the next recorded frame and hands out the events that came before it. At the
+    // end, or when setup() failed, it is false and the app exits.
+    bool advance(vector<Recorder::Event>& events) {
+        events.clear();
+        if (_frame >= _recording.frames.size()) {
+            if (!_finished) {
+                ofLogNotice("Replay") << "finished";
+                ofExit(_status);
+            }
+            _finished = true;
+            return false;
+        }
+        const Recorder::Frame& f = _recording.frames[_frame];
+        Clock::setFixed(f.clock);
+        while (_event < _recording.events.size() && _recording.events[_event].frame <= f.number) {
+            events.push_back(_recording.events[_event++]);
+        }
+
+        if (_settings.reanalyze) {
+            // the audio up to where the analysis was at this frame
+            uint64_t end = MIN(f.audioPosition - MIN(f.audioPosition, _recording.firstAudioSample), static_cast<uint64_t>(_recording.audio.size()));
+            if (end > _audio) {
+                _analyzer->process(_recording.audio.data() + _audio, end - _audio);
+                _audio = end;
+            }
+        } else if (f.sequence != 0 && f.sequence != _analysis.sequence) {
+            const float* bins = _recording.bins.data() + _frame * _recording.config.bandCount;
+            _analysis.sequence = f.sequence;
+            _analysis.time = f.time;
+            _analysis.rms = f.rms;
+            _analysis.smoothedVolume = f.smoothedVolume;
+            _analysis.scaledVolume = f.scaledVolume;
+            copy(bins, bins + _recording.config.bandCount, _analysis.bins.begin());
+            int nOnsets = _recording.config.onsetBands;
+            const uint32_t* onsetCounts = _recording.onsetCounts.data() + _frame * nOnsets;
+            copy(onsetCounts, onsetCounts + nOnsets, _analysis.onsetCount.begin());
+            const double* onsetTimes = _recording.onsetTimes.data() + _frame * nOnsets;
+            copy(onsetTimes, onsetTimes + nOnsets, _analysis.onsetTime.begin());
+            _analyzer->publish(_analysis);
+        }
+        _frame++;
+        return true;
+    }
+
+    // the recorded time of the frame that was just replayed
+    float getRecordedFrameMs() const {
+        return (_frame > 0 ? _recording.frames[_frame - 1].frameMs : 0);
+    }
+
+private:
+    Settings _settings;
+    Recorder::Recording _recording;
+    AudioAnalyzer* _analyzer = NULL;
+    size_t _frame = 0;
+    size_t _event = 0;
+    uint64_t _audio = 0;
+    AnalysisFrame _analysis;
+    int _status = 0;
+    bool _finished = false;
+};
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Lock-free single-producer / single-consumer ring of mono samples.
+// The audio callback writes, one other thread reads.
+class SampleRing {
+public:
+    SampleRing() : _head(0), _tail(0), _overflows(0) {
+    }
+
+    // capacity is rounded up to a power of two; call before either side runs
+    void allocate(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) {
+            n <<= 1;
+        }
+        _buffer.assign(n, 0);
+        _mask = n - 1;
+        _head = 0;
+        _tail = 0;
+    }
+
+    size_t capacity() const {
+        return _buffer.size();
+    }
+
+    // Producer: mixes interleaved channels down to mono. Drops the block if it does not fit.
+    bool push(const float* input, int frames, int channels) {
+        size_t head = _head.load(memory_order_relaxed);
+        size_t tail = _tail.load(memory_order_acquire);
+        if (_buffer.size() - (head - tail) < static_cast<size_t>(frames)) {
+            _overflows++;
+            return false;
+        }
+        float gain = 1.0 / channels;
+        for (int i = 0; i < frames; i++) {
+            float v = 0;
+            for (int c = 0; c < channels; c++) {
+                v += input[i * channels + c];
+            }
+            _buffer[(head + i) & _mask] = v * gain;
+        }
+        _head.store(head + frames, memory_order_release);
+        return true;
+    }
+
+    size_t available() const {
+        return _head.load(memory_order_acquire) - _tail.load(memory_order_relaxed);
+    }
+
+    // Consumer: copies out exactly n samples, or nothing if fewer are available.
+    bool pop(float* output, size_t n) {
+        size_t tail = _tail.load(memory_order_relaxed);
+        size_t head = _head.load(memory_order_acquire);
+        if (head - tail < n) {
+            return false;
+        }
+        for (size_t i = 0; i < n; i++) {
+            output[i] = _buffer[(tail + i) & _mask];
+        }
+        _tail.store(tail + n, memory_order_release);
+        return true;
+    }
+
+    uint64_t getOverflows() const {
+        return _overflows.load();
+    }
+
+private:
+    vector<float> _buffer;
+    size_t _mask = 0;
+    atomic<size_t> _head, _tail;
+    atomic<uint64_t> _overflows;
+};
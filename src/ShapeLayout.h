@@ -0,0 +1,92 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxJSON.h"
+
+// How many shapes ShapeState shows, their polygon corners and the spectrum
+// band each one follows, one array per field. Loaded from data/shapes.json:
+//
+//   {"count": 16, "corners": [3, 4, 5, 6], "columns": 4}
+//       count shapes, corners cycled, the bins split into equal bands
+//   {"shapes": [{"corners": 3, "firstBin": 0, "bins": 128}, ...]}
+//       every shape spelled out, bands may overlap
+//
+// Without the file it is the original four shapes, a triangle to a hexagon.
+struct ShapeLayout {
+    vector<int> corners;
+    vector<int> firstBin;
+    vector<int> binCount;
+    int columns = 0;    // 0: one row up to 8 shapes, a roughly square grid beyond
+
+    int size() const {
+        return corners.size();
+    }
+
+    void reset(int count, const vector<int>& cornerCycle, int nBins) {
+        count = MAX(1, count);
+        corners.resize(count);
+        firstBin.resize(count);
+        binCount.resize(count);
+        int width = MAX(3, nBins / count);
+        for (int i = 0; i < count; i++) {
+            corners[i] = MAX(3, cornerCycle[i % cornerCycle.size()]);
+            firstBin[i] = MIN(i * width, MAX(0, nBins - width));
+            binCount[i] = width;
+        }
+    }
+
+    bool load(string filename, int nBins) {
+        vector<int> cycle = {3, 4, 5, 6};
+        reset(cycle.size(), cycle, nBins);
+        columns = 0;
+
+        ofxJSONElement json;
+        if (!ofFile::doesFileExist(filename) || !json.open(filename)) {
+            return false;
+        }
+        if (json.isMember("columns")) {
+            columns = MAX(0, json["columns"].asInt());
+        }
+        if (json.isMember("shapes") && json["shapes"].size() > 0) {
+            corners.clear();
+            firstBin.clear();
+            binCount.clear();
+            for (int i = 0; i < json["shapes"].size(); i++) {
+                ofxJSONElement shape = json["shapes"][i];
+                int first = (shape.isMember("firstBin") ? shape["firstBin"].asInt() : 0);
+                int bins = (shape.isMember("bins") ? shape["bins"].asInt() : nBins / 4);
+                int n = (shape.isMember("corners") ? shape["corners"].asInt() : 3);
+                first = ofClamp(first, 0, nBins - 3);
+                corners.push_back(MAX(3, n));
+                firstBin.push_back(first);
+                binCount.push_back(ofClamp(bins, 3, nBins - first));
+            }
+        } else {
+            if (json.isMember("corners") && json["corners"].size() > 0) {
+                cycle.clear();
+                for (int i = 0; i < json["corners"].size(); i++) {
+                    cycle.push_back(json["corners"][i].asInt());
+                }
+            }
+            int count = (json.isMember("count") ? json["count"].asInt() : cycle.size());
+            reset(count, cycle, nBins);
+        }
+        return true;
+    }
+
+    // centre and scale of cell i out of n, in a w x h view centred on the origin
+    static void getCell(int i, int n, int columns, float w, float h, float& x, float& y, float& scale) {
+        int cols = columns;
+        if (cols <= 0) {
+            cols = (n <= 8 ? n : ceil(sqrt(n * w / h)));
+        }
+        cols = ofClamp(cols, 1, MAX(n, 1));
+        int rows = (n + cols - 1) / cols;
+        float cellWidth = w / cols;
+        float cellHeight = h / rows;
+        x = cellWidth * (i % cols + 0.5) - w * 0.5;
+        y = cellHeight * (i / cols + 0.5) - h * 0.5;
+        // 0.7 in a quarter of the width, as the four-shape row always was
+        scale = 0.7 * MIN(cellWidth, cellHeight) / (w * 0.25);
+    }
+};
@@ -1,10 +1,25 @@
 #include "ofxState.h"
-#include "ofxEasyFft.h"
+#include "SharedData.h"
+#include "Clock.h"
 #include "Util.h"
+#include "RadialRing.h"
+#include "SpectrumDisplacement.h"
+#include "GlyphAtlas.h"
+#include "ShapeLayout.h"
+#include "Kernels.h"
+#include "GeometryStage.h"
+#include "OnsetDetector.h"
+#include "PhaseTimer.h"
+#include "Ramp.h"
+#include "ofxJSON.h"
 
-#define N_POLYS 4
+// outline points per shape when Polygon mode runs on the GPU
+#define GPU_POLYGON_POINTS 8192
+// Typography smoothing runs from 1 to SMOOTH_LEVELS
+#define SMOOTH_LEVELS 100
+#define GLYPH_POINTS 256
 
-class ShapeState : public itg::ofxState<ofxEasyFft> {
+class ShapeState : public itg::ofxState<SharedData> {
 public:
     enum Mode {
         CircleSingle,
@@ -13,212 +28,124 @@ public:
         Typography
     };
     
+    ~ShapeState() {
+        // before any member the jobs use goes away
+        discardGeometry();
+    }
+    
     string getName() {
         return "Shapes";
     }
     
+    void stateEnter() {
+        // the chain is shared, each state sets the passes it draws with
+        getSharedData().post.setEnabled(PostChain::Fxaa, true);
+        getSharedData().post.setEnabled(PostChain::Bloom, true);
+    }
+    
     void setup() {
-        for (int i = 0; i < N_POLYS; i++) {
-            if (i == 0) {
-                _posTween.setParameters(_linear, ofxTween::easeInOut, 0, 0, 0, 0);
-                _scaleTween.setParameters(_linear, ofxTween::easeInOut, 1, 1, 0, 0);
-            } else {
-                _posTween.addValue(0, 0);
-                _scaleTween.addValue(1, 1);
-            }
-            _alphaTween[i].setParameters(_linear, ofxTween::easeInOut, 0, 0, 0, 0);
-            _mean[i] = 0;
-        }
-        
-        _post.init(ofGetWidth(), ofGetHeight());
-        _post.createPass<FxaaPass>()->setEnabled(true);
-        _post.createPass<BloomPass>()->setEnabled(true);
-        
-        _font.load("HelveticaNeue.dfont", 300, true, true, true);
+        loadText("typography.json");
         _mode = CircleSingle;
-        _useMean = true;
         _autoFill = false;
         _nBuffers = 1024;
+        
+        _gpuPolygons = _displacement.setup(_nBuffers);
+        _layout.load("shapes.json", _nBuffers);
+        setupShapes();
+        ofAddListener(getSharedData().analyzer.restartEvent, this, &ShapeState::onAnalyzerRestart);
     }
     
     void update() {
-        _posTween.update();
-        _scaleTween.update();
-        for (int i = 0; i < N_POLYS; i++) {
-            _alphaTween[i].update();
+        // The fence: what the workers built while the last frame drew is shown this frame
+        if (_geometry.finish()) {
+            presentGeometry();
         }
         
-        ofxEasyFft& fft = getSharedData();
-        vector<float> buffer = fft.getBins();
-        Util::normalize(buffer);
-        
-        int nPoints = _nBuffers / N_POLYS;
-        
-        float fillAlpha = 128;
-        
-        switch (_mode) {
-            case CircleSingle:
-            case CircleMulti:
-                for (int i = 0; i < N_POLYS; i++) {
-                    float mean = 0;
-                    float max = 0;
-                    
-                    _polys[i].clear();
-                    for (int j = 0; j < nPoints; j++) {
-                        int index = i * nPoints + j;
-                        float rad = TWO_PI / nPoints * j;
-                        float dr = (isnan(buffer[index]) ? 0 : buffer[index] * 100);
-                        float r = dr + 100;
-                        float x = r * cos(rad);
-                        float y = r * sin(rad);
-                        _polys[i].addVertex(ofVec3f(x, y, 0));
-                        
-                        if (!isnan(buffer[index])) {
-                            mean += buffer[index];
-                            max = MAX(buffer[index], max);
-                        }
-                    }
-                    _polys[i].close();
-                    _tessellator.tessellateToMesh(_polys[i], OF_POLY_WINDING_ODD, _meshes[i]);
-                    
-                    mean /= nPoints;
-                    if (_autoFill) {
-                        if (_useMean) {
-                            if (1.25 < mean / _mean[i]) {
-                                _alphaTween[i].setParameters(_linear, ofxTween::easeInOut, fillAlpha, 0, 250, 0);
-                            }
-                        } else {
-                            if (1.5 < max / _max[i]) {
-                                _alphaTween[i].setParameters(_linear, ofxTween::easeInOut, fillAlpha, 0, 250, 0);
-                            }
-                        }
-                    }
-                    _mean[i] = mean;
-                    _max[i] = max;
-                }
-                break;
-            case Polygon:
-                for (int i = 0; i < N_POLYS; i++) {
-                    float mean = 0;
-                    float max = 0;
-                    
-                    _polys[i].clear();
-                    for (int j = 0; j < _shapes[i].size(); j++) {
-                        int index = i * nPoints + j;
-                        ofVec3f norm = _shapes[i].getNormalAtIndex(j);
-                        float d = (isnan(buffer[index])? 0 : buffer[index] * 100);
-                        ofVec3f v(_shapes[i][j].x + norm.x * d, _shapes[i][j].y + norm.y * d, 0);
-                        _polys[i].addVertex(v);
-                        
-                        if (!isnan(buffer[index])) {
-                            mean += buffer[index];
-                            max = MAX(buffer[index], max);
-                        }
-                    }
-                    _polys[i].close();
-                    _tessellator.tessellateToMesh(_polys[i], OF_POLY_WINDING_NONZERO, _meshes[i]);
-                    
-                    mean /= nPoints;
-                    if (_autoFill) {
-                        if (_useMean) {
-                            if (1.25 < mean / _mean[i]) {
-                                _alphaTween[i].setParameters(_linear, ofxTween::easeInOut, fillAlpha, 0, 250, 0);
-                            }
-                        } else {
-                            if (1.5 < max / _max[i]) {
-                                _alphaTween[i].setParameters(_linear, ofxTween::easeInOut, fillAlpha, 0, 250, 0);
-                            }
-                        }
-                    }
-                    _mean[i] = mean;
-                    _max[i] = max;
-                }
-                break;
-            case Typography:
-                for (int i = 0; i < N_POLYS; i++) {
-                    float mean = 0;
-                    float max = 0;
-                    
-                    for (int j = 0; j < nPoints; j++) {
-                        int index = i * nPoints + j;
-                        if (!isnan(buffer[index])) {
-                            mean += buffer[index];
-                            max = MAX(buffer[index], max);
-                        }
-                    }
-                    mean /= nPoints;
-                    if (_autoFill) {
-                        if (_useMean) {
-                            if (1.25 < mean / _mean[i]) {
-                                _alphaTween[i].setParameters(_linear, ofxTween::easeInOut, fillAlpha, 64, 250, 0);
-                            }
-                        } else {
-                            if (1.5 < max / _max[i]) {
-                                _alphaTween[i].setParameters(_linear, ofxTween::easeInOut, fillAlpha, 64, 250, 0);
-                            }
-                        }
-                    }
-                    _mean[i] = mean;
-                    _max[i] = max;
-                }
-                
-                int smooth = ofMap(_scaledVol, 0.25, 0.75, 100, 1, true);
-                
-                for (int i = 0; i < N_POLYS; i++) {
-                    _polys[i].clear();
-                    _polys[i] = _chars[i].getSmoothed(smooth, 0.0);
-                    _tessellator.tessellateToMesh(_polys[i], OF_POLY_WINDING_NONZERO, _meshes[i]);
-                }
-                
-                break;
+        AudioAnalyzer::Frame frame = getSharedData().analyzer.getFrame();
+        if (frame) {
+            // pinned until the fence, the jobs read its bins in place
+            _geometryFrame = move(frame);
+            launchGeometry();
         }
-        
-        vector<float> audio = fft.getAudio();
-        float curVol = Util::calcVolume(audio);
-        _smoothedVol *= SMOOTH_FACTOR;
-        _smoothedVol += (1.0 - SMOOTH_FACTOR) * curVol;
-        _scaledVol = ofMap(_smoothedVol, 0.0, Util::getVolumeMax(), 0.0, 1.0, true);
     }
     
     void draw() {
-        _post.begin(_easyCam);
+        getSharedData().post.begin(_easyCam);
         ofBackground(0);
         ofSetColor(255);
+        uint64_t now = Clock::getElapsedTimeMillis();
         
         ofPushMatrix();
         
         switch(_mode) {
             case CircleSingle:
             case CircleMulti:
-            case Polygon:
-            case Typography:
-                for (int i = 0; i < N_POLYS; i++) {
+            case Polygon: {
+                int nShapes = _layout.size();
+                bool displaced = (_mode == Polygon && _gpuPolygons);
+                if (displaced) {
+                    _displacement.begin(100);
+                }
+                for (int i = 0; i < nShapes; i++) {
                     ofPushMatrix();
-                    float x = _posTween.getTarget(i);
-                    ofTranslate(x, 0);
-                    float angle = (i % 2 == 0 ? 1.0 : -1.0) * fmod(ofGetElapsedTimef() * 3.0, 360);
+                    ofTranslate(_position[i].get(now), _position[nShapes + i].get(now));
+                    float angle = (i % 2 == 0 ? 1.0 : -1.0) * fmod(Clock::getElapsedTimef() * 3.0, 360);
                     ofRotateZ(angle);
-                    if (_mode == Typography) {
-                        ofRotateX(angle);
+                    float scale = _scale[i].get(now);
+                    ofScale(scale, scale);
+                    
+                    float alpha = _fillAlpha[i].get(now);
+                    if (_mode == CircleSingle || _mode == CircleMulti) {
+                        ofSetColor(255, alpha);
+                        _rings[i].drawFill();
+                        ofSetColor(255, 192);
+                        _rings[i].drawOutline();
+                    } else if (displaced) {
+                        ofSetColor(255, alpha);
+                        _displaced[i].drawFill();
+                        ofSetColor(255, 192);
+                        _displaced[i].drawOutline();
+                    } else {
+                        ofSetColor(255, alpha);
+                        _meshes.front()[i].draw();
+                        ofSetColor(255, 192);
+                        _polys.front()[i].draw();
                     }
-                    float scale = _scaleTween.getTarget(i);
+                    ofPopMatrix();
+                }
+                if (displaced) {
+                    _displacement.end();
+                }
+                break;
+            }
+            case Typography: {
+                // one cell per glyph, laid out like the shapes
+                int nGlyphs = _glyphIds.size();
+                for (int i = 0; i < nGlyphs; i++) {
+                    float x, y, scale;
+                    ShapeLayout::getCell(i, nGlyphs, 0, ofGetWidth(), ofGetHeight(), x, y, scale);
+                    ofPushMatrix();
+                    ofTranslate(x, y);
+                    float angle = (i % 2 == 0 ? 1.0 : -1.0) * fmod(Clock::getElapsedTimef() * 3.0, 360);
+                    ofRotateZ(angle);
+                    ofRotateX(angle);
                     ofScale(scale, scale);
                     
-                    float alpha = _alphaTween[i].getTarget(0);
-                    ofSetColor(255, alpha);
-                    _meshes[i].draw();
+                    ofSetColor(255, _glyphAlpha[i].get(now));
+                    _atlas.drawFill(_glyphIds[i], _smoothLevel);
                     ofSetColor(255, 192);
-                    _polys[i].draw();
+                    _atlas.drawOutline(_glyphIds[i], _smoothLevel);
                     ofPopMatrix();
                 }
                 break;
+            }
             default:
                 break;
         }
         
         ofPopMatrix();
         
-        _post.end();
+        getSharedData().post.end();
         
         if (_debugMode) {
             ofSetColor(128);
@@ -229,47 +156,34 @@ public:
     }
 
     void keyPressed(int key) {
+        if (key == OF_KEY_RIGHT || key == 't') {
+            // the jobs in flight read the geometry about to change, drop their frame
+            discardGeometry();
+        }
         if (key == OF_KEY_RIGHT) {
             if (_mode == CircleSingle) {
                 _mode = CircleMulti;
                 _autoFill = true;
-                for (int i = 0; i < N_POLYS; i++) {
-                    float x = ofGetWidth() / N_POLYS * (i + 0.5) - ofGetWidth() * 0.5;
-                    if (i == 0) {
-                        _posTween.setParameters(_linear, ofxTween::easeInOut, 0, x, 25000, 0);
-                        _scaleTween.setParameters(_linear, ofxTween::easeInOut, 1.0, 0.7, 25000, 0);
-                    } else {
-                        _posTween.addValue(0, x);
-                        _scaleTween.addValue(1.0, 0.7);
-                    }
-                }
+                moveLayout(25000, true);
             } else if (_mode == CircleMulti){
                 _mode = Polygon;
-                setupPolygons();
             } else if (_mode == Polygon) {
                 _mode = Typography;
                 setupText();
             } else if (_mode == Typography){
                 _mode = CircleSingle;
                 _autoFill = false;
-                for (int i = 0; i < N_POLYS; i++) {
-                    float x = ofGetWidth() / N_POLYS * (i + 0.5) - ofGetWidth() * 0.5;
-                    if (i == 0) {
-                        _posTween.setParameters(_expo, ofxTween::easeInOut, x, 0, 0, 0);
-                        _scaleTween.setParameters(_expo, ofxTween::easeInOut, 0.7, 1.0, 0, 0);
-                    } else {
-                        _posTween.addValue(x, 0);
-                        _scaleTween.addValue(0.7, 1.0);
-                    }
-                }
+                moveLayout(0, false);
             }
+        } else if (key == 't' && _mode == Typography) {
+            _textIndex = (_textIndex + 1) % _texts.size();
+            setupText();
         } else if (key == 'd') {
             _debugMode = !_debugMode;
         }
     }
     
 private:
-    bool _useMean;
     bool _autoFill;
     bool _debugMode = false;
     int _nBuffers;
@@ -277,32 +191,189 @@ private:
     Mode _mode;
     ofEasyCam _easyCam;
 
-    ofPolyline _polys[N_POLYS], _chars[N_POLYS], _shapes[N_POLYS];
-    ofMesh _meshes[N_POLYS];
-    float _mean[N_POLYS], _max[N_POLYS];
-    int _nVerts[N_POLYS] = {3, 4, 5, 6};
+    // one entry per shape of _layout
+    ShapeLayout _layout;
+    vector<ofPolyline> _shapes;
+    DoubleBuffer<vector<ofPolyline> > _polys;
+    DoubleBuffer<vector<ofMesh> > _meshes;
+    vector<RadialRing> _rings;
+    vector<vector<ofVec3f> > _ringVertices;
+    vector<DisplacedShape> _displaced;
+    vector<Ramp> _fillAlpha;
+    
+    SpectrumDisplacement _displacement;
+    bool _gpuPolygons = false;
+    GlyphAtlas _atlas;
+    vector<string> _texts;
+    int _textIndex = 0;
+    vector<int> _glyphIds;
+    vector<int> _glyphFirst, _glyphCount;
+    vector<Ramp> _glyphAlpha;
+    int _smoothLevel = 0;
     
+    // one job per shape, or per glyph in Typography, building the next frame
+    GeometryStage _geometry;
+    AudioAnalyzer::Frame _geometryFrame;
     ofTessellator _tessellator;
     
-    ofxPostProcessing _post;
+    // x of every shape, then y of every shape
+    vector<Ramp> _position;
+    vector<Ramp> _scale;
+    
+    float _scaledVol = 0;
+    OnsetReader _onsets;
+    
+    void setupShapes() {
+        discardGeometry();
+        int n = _layout.size();
+        _shapes.assign(n, ofPolyline());
+        _polys.front().assign(n, ofPolyline());
+        _polys.back().assign(n, ofPolyline());
+        _meshes.front().assign(n, ofMesh());
+        _meshes.back().assign(n, ofMesh());
+        _displaced.resize(n);
+        _rings.resize(n);
+        _ringVertices.resize(n);
+        for (int i = 0; i < n; i++) {
+            _rings[i].setup(_layout.binCount[i], 100);
+        }
+        _fillAlpha.assign(n, Ramp(0));
+        moveLayout(0, false);
+        // ahead of the switch to Polygon, which used to build them on the spot
+        setupPolygons();
+    }
+    
+    // from the centre to the grid when spread, back again otherwise
+    void moveLayout(uint64_t durationMs, bool spread) {
+        uint64_t now = Clock::getElapsedTimeMillis();
+        int n = _layout.size();
+        _position.resize(n * 2);
+        _scale.resize(n);
+        vector<float> x(n), y(n), scale(n);
+        for (int i = 0; i < n; i++) {
+            ShapeLayout::getCell(i, n, _layout.columns, ofGetWidth(), ofGetHeight(), x[i], y[i], scale[i]);
+        }
+        for (int i = 0; i < n * 2; i++) {
+            float to = (i < n ? x[i] : y[i - n]);
+            float from = (spread ? 0 : to);
+            if (!spread) {
+                to = 0;
+            }
+            _position[i].start(from, to, now, durationMs);
+        }
+        for (int i = 0; i < n; i++) {
+            float from = (spread ? 1.0 : scale[i]);
+            float to = (spread ? scale[i] : 1.0);
+            _scale[i].start(from, to, now, durationMs);
+        }
+    }
+    
+    // Queues the jobs for _geometryFrame: one per shape when the mode moves them on the CPU,
+    // none otherwise, and presentGeometry() still runs after the fence
+    void launchGeometry() {
+        bool cpu = (_mode == CircleSingle || _mode == CircleMulti || (_mode == Polygon && !_gpuPolygons));
+        _geometry.launch(cpu ? _layout.size() : 0, [this](int i) { buildGeometry(i); });
+    }
+    
+    // Job i. Writes only entry i of the back buffers.
+    void buildGeometry(int i) {
+        PhaseTimer::Scope scope(PhaseTimer::Geometry);
+        const vector<float>& bins = _geometryFrame->bins;
+        int nBins = bins.size();
+        const vector<int>& first = _layout.firstBin;
+        const vector<int>& count = _layout.binCount;
+        
+        if (_mode == CircleSingle || _mode == CircleMulti) {
+            int from = MIN(first[i], nBins);
+            _rings[i].compute(bins.data() + from, MIN(count[i], nBins - from), 100, _ringVertices[i]);
+        } else if (_mode == Polygon && !_gpuPolygons) {
+            ofPolyline& poly = _polys.back()[i];
+            poly.clear();
+            for (int j = 0; j < _shapes[i].size(); j++) {
+                int index = first[i] + j;
+                ofVec3f norm = _shapes[i].getNormalAtIndex(j);
+                float d = (index < nBins ? bins[index] * 100 : 0);
+                poly.addVertex(_shapes[i][j].x + norm.x * d, _shapes[i][j].y + norm.y * d, 0);
+            }
+            poly.close();
+            // the tessellator keeps state between calls, so one per job
+            PhaseTimer::Scope tessellation(PhaseTimer::Tessellation);
+            ofTessellator tessellator;
+            tessellator.tessellateToMesh(poly, OF_POLY_WINDING_NONZERO, _meshes.back()[i]);
+        }
+    }
+    
+    // Render thread, after the fence: swaps and uploads what the jobs built
+    void presentGeometry() {
+        PhaseTimer::Scope scope(PhaseTimer::Geometry);
+        _onsets.update(*_geometryFrame);
+        _scaledVol = _geometryFrame->scaledVolume;
+        switch (_mode) {
+            case CircleSingle:
+            case CircleMulti:
+                for (int i = 0; i < _rings.size(); i++) {
+                    _rings[i].upload(_ringVertices[i]);
+                }
+                updateFills(_layout.firstBin, _layout.binCount, _fillAlpha, 0);
+                break;
+            case Polygon:
+                if (_gpuPolygons) {
+                    // the vertex shader displaces the outlines from the uploaded bins
+                    _displacement.update(_geometryFrame->bins);
+                } else {
+                    _polys.swap();
+                    _meshes.swap();
+                }
+                updateFills(_layout.firstBin, _layout.binCount, _fillAlpha, 0);
+                break;
+            case Typography: {
+                // each glyph follows its own slice of the spectrum, however long the text is
+                updateFills(_glyphFirst, _glyphCount, _glyphAlpha, 64);
+                int smooth = ofMap(_scaledVol, 0.25, 0.75, SMOOTH_LEVELS, 1, true);
+                _smoothLevel = smooth - 1;
+                break;
+            }
+        }
+    }
     
-    ofTrueTypeFont _font;
+    // Waits for the jobs in flight and throws their frame away, before anything they read changes
+    void discardGeometry() {
+        _geometry.finish();
+    }
     
-    ofxTween _posTween, _scaleTween, _alphaTween[N_POLYS];
-    ofxEasingLinear _linear;
-    ofxEasingCubic _cubic;
-    ofxEasingExpo _expo;
+    // the jobs read the analyzer's frame in place, so they are done and it is released first
+    void onAnalyzerRestart(AnalysisConfig& config) {
+        discardGeometry();
+        _geometryFrame = AudioAnalyzer::Frame();
+    }
     
-    float _smoothedVol = 0, _scaledVol = 0;
+    // Fades a fill in on each onset in the part of the spectrum a shape, or glyph, follows
+    void updateFills(const vector<int>& first, const vector<int>& count, vector<Ramp>& alpha, float toAlpha) {
+        if (!_autoFill) {
+            return;
+        }
+        uint64_t now = Clock::getElapsedTimeMillis();
+        int n = MIN(first.size(), alpha.size());
+        int nBins = _geometryFrame->bins.size();
+        float fillAlpha = 128;
+        for (int i = 0; i < n; i++) {
+            if (_onsets.fired(first[i], count[i], nBins)) {
+                alpha[i].start(fillAlpha, toAlpha, now, 250);
+            }
+        }
+    }
     
     void setupPolygons() {
-        for (int i = 0; i < N_POLYS; i++) {
+        for (int i = 0; i < _layout.size(); i++) {
+            int corners = _layout.corners[i];
+            int nPoints = _layout.binCount[i];
+            int resolution = (_gpuPolygons ? GPU_POLYGON_POINTS : nPoints);
             _shapes[i].clear();
-            int n = _nBuffers / N_POLYS / _nVerts[i];
+            int n = MAX(1, resolution / corners);
             
-            for (int j = 0; j < _nVerts[i]; j++) {
-                float radStart = TWO_PI / _nVerts[i] * j;
-                float radEnd = TWO_PI / _nVerts[i] * ((j + 1) % _nVerts[i]);
+            for (int j = 0; j < corners; j++) {
+                float radStart = TWO_PI / corners * j;
+                float radEnd = TWO_PI / corners * ((j + 1) % corners);
                 
                 float r = 100;
                 ofPoint from(r * cos(radStart), r * sin(radStart));
@@ -314,40 +385,55 @@ private:
                 }
             }
             _shapes[i].close();
-            _polys[i] = _shapes[i].getResampledByCount(_nBuffers / N_POLYS);
-            _tessellator.tessellateToMesh(_polys[i], OF_POLY_WINDING_NONZERO, _meshes[i]);
+            if (_gpuPolygons) {
+                // the same bins as the CPU path, spread over more points
+                _displaced[i].setup(_shapes[i], _layout.firstBin[i], static_cast<float>(_shapes[i].size()) * nPoints / resolution);
+            } else {
+                _polys.front()[i] = _shapes[i].getResampledByCount(nPoints);
+                _tessellator.tessellateToMesh(_polys.front()[i], OF_POLY_WINDING_NONZERO, _meshes.front()[i]);
+            }
         }
     }
     
-    void setupText() {
-        string text = "moph";
-        
-        for (int i = 0; i < N_POLYS; i++) {
-            ofTTFCharacter path = _font.getStringAsPoints(text)[i];
-            vector<ofPolyline> polylines = path.getOutline();
-            
-            int n = polylines.size();
-            int pathIndex = 0;
-            float area = 0;
-            for (int j = 0; j < n; j++) {
-                float a = polylines[j].getBoundingBox().getArea();
-                if (area < a) {
-                    pathIndex = j;
-                    area = a;
-                }
+    // font and strings for Typography, "moph" in Helvetica Neue unless typography.json says otherwise:
+    //   {"font": "HelveticaNeue.dfont", "size": 300, "texts": ["moph", "..."]}
+    void loadText(string filename) {
+        string font = "HelveticaNeue.dfont";
+        int size = 300;
+        _texts.clear();
+        ofxJSONElement json;
+        if (ofFile::doesFileExist(filename) && json.open(filename)) {
+            if (json.isMember("font")) {
+                font = json["font"].asString();
             }
-            auto poly = polylines[pathIndex].getResampledByCount(_nBuffers / N_POLYS);
-            ofRectangle bb = poly.getBoundingBox();
-            
-            float cx = bb.x + bb.width * 0.5;
-            float cy = bb.y + bb.height * 0.5;
-            
-            _chars[i].clear();
-            for (int j = 0; j < poly.size(); j++) {
-                _chars[i].addVertex(poly[j].x - cx, poly[j].y - cy);
+            if (json.isMember("size")) {
+                size = json["size"].asInt();
             }
-            _chars[i].close();
-            _tessellator.tessellateToMesh(_chars[i], OF_POLY_WINDING_NONZERO, _meshes[i]);
+            for (int i = 0; i < json["texts"].size(); i++) {
+                _texts.push_back(json["texts"][i].asString());
+            }
+        }
+        if (_texts.empty()) {
+            _texts.push_back("moph");
+        }
+        _textIndex = 0;
+        _atlas.setup(font, size, GLYPH_POINTS, SMOOTH_LEVELS);
+        // every glyph extracted now, so switching to a text never loads the font mid-show
+        for (int i = 0; i < _texts.size(); i++) {
+            _atlas.getGlyphs(_texts[i]);
+        }
+    }
+    
+    void setupText() {
+        // only glyphs the atlas has not seen yet are extracted and tessellated
+        _glyphIds = _atlas.getGlyphs(_texts[_textIndex]);
+        int n = _glyphIds.size();
+        int width = MAX(1, _nBuffers / MAX(n, 1));
+        _glyphFirst.resize(n);
+        _glyphCount.assign(n, width);
+        for (int i = 0; i < n; i++) {
+            _glyphFirst[i] = i * width;
         }
+        _glyphAlpha.assign(n, Ramp(0));
     }
 };
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "AudioAnalyzer.h"
+#include "PostChain.h"
+
+// What ofApp hands to every state through ofxStateMachine.
+struct SharedData {
+    AudioAnalyzer analyzer;
+    PostChain post;
+};
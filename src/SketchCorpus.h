@@ -0,0 +1,379 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxJSON.h"
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifndef TARGET_WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Compact binary form of a QuickDraw .ndjson file.
+//
+//   Header
+//   uint32 strokeOffsets[nDrawings + 1]   first stroke of each drawing
+//   uint32 vertexOffsets[nStrokes + 1]    first vertex of each stroke
+//   int16  vertices[nVertices * 2]        x, y pairs
+//
+// Files are written in host byte order (little endian on every target we ship).
+class SketchCorpus {
+public:
+    struct Header {
+        char magic[4];
+        uint32_t version;
+        uint32_t nDrawings;
+        uint32_t nStrokes;
+        uint32_t nVertices;
+        uint32_t limit;     // _maxSamples the file was converted with, 0 if not truncated
+    };
+
+    // Flat arrays filled while parsing; chunks are appended in line order.
+    class Builder {
+    public:
+        vector<uint32_t> strokeOffsets;
+        vector<uint32_t> vertexOffsets;
+        vector<int16_t> vertices;
+
+        Builder() {
+            clear();
+        }
+
+        void clear() {
+            strokeOffsets.assign(1, 0);
+            vertexOffsets.assign(1, 0);
+            vertices.clear();
+        }
+
+        int size() const {
+            return strokeOffsets.size() - 1;
+        }
+
+        void addVertex(int x, int y) {
+            vertices.push_back(static_cast<int16_t>(x));
+            vertices.push_back(static_cast<int16_t>(y));
+        }
+
+        void endStroke() {
+            uint32_t end = vertices.size() / 2;
+            if (end != vertexOffsets.back()) {
+                vertexOffsets.push_back(end);
+            }
+        }
+
+        void endDrawing() {
+            strokeOffsets.push_back(vertexOffsets.size() - 1);
+        }
+
+        // drops a drawing that failed to parse half way through
+        void discardDrawing() {
+            vertexOffsets.resize(strokeOffsets.back() + 1);
+            vertices.resize(vertexOffsets.back() * 2);
+        }
+
+        void append(const Builder& other, int maxDrawings) {
+            int n = MIN(other.size(), maxDrawings);
+            if (n <= 0) {
+                return;
+            }
+            uint32_t strokeBase = vertexOffsets.size() - 1;
+            uint32_t vertexBase = vertices.size() / 2;
+            uint32_t nStrokes = other.strokeOffsets[n];
+            uint32_t nVertices = other.vertexOffsets[nStrokes];
+
+            for (int i = 1; i <= n; i++) {
+                strokeOffsets.push_back(strokeBase + other.strokeOffsets[i]);
+            }
+            for (uint32_t i = 1; i <= nStrokes; i++) {
+                vertexOffsets.push_back(vertexBase + other.vertexOffsets[i]);
+            }
+            vertices.insert(vertices.end(), other.vertices.begin(), other.vertices.begin() + nVertices * 2);
+        }
+    };
+
+    SketchCorpus() {
+        reset();
+    }
+
+    ~SketchCorpus() {
+        close();
+    }
+
+    // Maps a corpus file written by save(). Only the first maxDrawings are exposed.
+    bool load(string filename, int maxDrawings) {
+        close();
+        string path = ofToDataPath(filename, true);
+
+#ifndef TARGET_WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+            ::close(fd);
+            return false;
+        }
+        void* p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            return false;
+        }
+        _map = p;
+        _mapSize = st.st_size;
+        const char* data = static_cast<const char*>(p);
+        size_t size = _mapSize;
+#else
+        ofFile file(path, ofFile::ReadOnly, true);
+        if (!file.exists()) {
+            return false;
+        }
+        _fileBuffer = ofBuffer(file);
+        const char* data = _fileBuffer.getData();
+        size_t size = _fileBuffer.size();
+#endif
+
+        if (size < sizeof(Header)) {
+            close();
+            return false;
+        }
+        const Header* header = reinterpret_cast<const Header*>(data);
+        if (memcmp(header->magic, "MSKC", 4) != 0 || header->version != VERSION) {
+            close();
+            return false;
+        }
+        // in 64 bits, so counts near 2^32 cannot wrap past the check
+        uint64_t expected = sizeof(Header)
+            + sizeof(uint32_t) * (static_cast<uint64_t>(header->nDrawings) + 1)
+            + sizeof(uint32_t) * (static_cast<uint64_t>(header->nStrokes) + 1)
+            + sizeof(int16_t) * static_cast<uint64_t>(header->nVertices) * 2;
+        if (size < expected) {
+            close();
+            return false;
+        }
+
+        const uint32_t* strokeOffsets = reinterpret_cast<const uint32_t*>(data + sizeof(Header));
+        const uint32_t* vertexOffsets = strokeOffsets + header->nDrawings + 1;
+        // a corrupt table would send operator[] and TileRenderer::setup outside the file
+        if (!isValidTable(strokeOffsets, header->nDrawings, header->nStrokes)
+            || !isValidTable(vertexOffsets, header->nStrokes, header->nVertices)) {
+            close();
+            return false;
+        }
+
+        _header = *header;
+        _strokeOffsets = strokeOffsets;
+        _vertexOffsets = vertexOffsets;
+        _vertices = reinterpret_cast<const int16_t*>(_vertexOffsets + header->nStrokes + 1);
+        _size = MIN(static_cast<int>(header->nDrawings), maxDrawings);
+        _paths.clear();
+        _paths.resize(_size);
+        return true;
+    }
+
+    // Takes over parsed arrays when there is no usable corpus file.
+    void assign(Builder& builder) {
+        close();
+        _owned.strokeOffsets.swap(builder.strokeOffsets);
+        _owned.vertexOffsets.swap(builder.vertexOffsets);
+        _owned.vertices.swap(builder.vertices);
+        builder.clear();
+
+        _header.nDrawings = _owned.size();
+        _header.nStrokes = _owned.vertexOffsets.size() - 1;
+        _header.nVertices = _owned.vertices.size() / 2;
+        _strokeOffsets = _owned.strokeOffsets.data();
+        _vertexOffsets = _owned.vertexOffsets.data();
+        _vertices = _owned.vertices.data();
+        _size = _header.nDrawings;
+        _paths.clear();
+        _paths.resize(_size);
+    }
+
+    static bool save(string filename, const Builder& builder, int limit) {
+        Header header;
+        memcpy(header.magic, "MSKC", 4);
+        header.version = VERSION;
+        header.nDrawings = builder.size();
+        header.nStrokes = builder.vertexOffsets.size() - 1;
+        header.nVertices = builder.vertices.size() / 2;
+        header.limit = (builder.size() == limit ? limit : 0);
+
+        string path = ofToDataPath(filename, true);
+        string tmp = path + ".tmp";
+        ofstream out(tmp.c_str(), ios::binary | ios::trunc);
+        if (!out) {
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(builder.strokeOffsets.data()), sizeof(uint32_t) * builder.strokeOffsets.size());
+        out.write(reinterpret_cast<const char*>(builder.vertexOffsets.data()), sizeof(uint32_t) * builder.vertexOffsets.size());
+        out.write(reinterpret_cast<const char*>(builder.vertices.data()), sizeof(int16_t) * builder.vertices.size());
+        out.close();
+        if (!out) {
+            remove(tmp.c_str());
+            return false;
+        }
+        // rename so a running instance never maps a half written file
+        return rename(tmp.c_str(), path.c_str()) == 0;
+    }
+
+    // Reference jsoncpp reader, one DOM per line. SketchIngest is the fast path.
+    static bool parseNdjson(string filename, Builder& builder, int maxDrawings) {
+        ofFile file(filename);
+        if (!file.exists()) {
+            return false;
+        }
+        ofBuffer buffer(file);
+        builder.clear();
+        for (ofBuffer::Line it = buffer.getLines().begin(), end = buffer.getLines().end(); it != end; ++it) {
+            string line = *it;
+            ofxJSONElement json;
+            if (json.parse(line)) {
+                auto strokes = json["drawing"];
+                for (int i = 0; i < strokes.size(); i++) {
+                    auto xVerts = strokes[i][0];
+                    auto yVerts = strokes[i][1];
+                    for (int j = 0; j < xVerts.size(); j++) {
+                        builder.addVertex(xVerts[j].asInt(), yVerts[j].asInt());
+                    }
+                    builder.endStroke();
+                }
+                builder.endDrawing();
+                if (builder.size() == maxDrawings) {
+                    break;
+                }
+            }
+        }
+        buffer.clear();
+        return true;
+    }
+
+    // True when target exists, is newer than source and holds enough drawings.
+    static bool isUpToDate(string source, string target, int maxDrawings) {
+        struct stat src, dst;
+        if (stat(ofToDataPath(target, true).c_str(), &dst) != 0) {
+            return false;
+        }
+        if (stat(ofToDataPath(source, true).c_str(), &src) == 0 && dst.st_mtime < src.st_mtime) {
+            return false;
+        }
+        ifstream in(ofToDataPath(target, true).c_str(), ios::binary);
+        Header header;
+        if (!in.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return false;
+        }
+        if (memcmp(header.magic, "MSKC", 4) != 0 || header.version != VERSION) {
+            return false;
+        }
+        // a truncated file is only good enough if it was cut at or above what we ask for
+        return header.limit == 0 || maxDrawings <= static_cast<int>(header.limit);
+    }
+
+    static string corpusPathFor(string source) {
+        return ofFilePath::removeExt(source) + ".corpus";
+    }
+
+    int size() const {
+        return _size;
+    }
+
+    int getNumStrokes(int drawing) const {
+        return _strokeOffsets[drawing + 1] - _strokeOffsets[drawing];
+    }
+
+    int getFirstStroke(int drawing) const {
+        return _strokeOffsets[drawing];
+    }
+
+    int getNumVertices(int stroke) const {
+        return _vertexOffsets[stroke + 1] - _vertexOffsets[stroke];
+    }
+
+    // x, y pairs of a stroke
+    const int16_t* getVertices(int stroke) const {
+        return _vertices + _vertexOffsets[stroke] * 2;
+    }
+
+    // Builds the ofPath for a drawing the first time it is asked for.
+    ofPath& operator[](int i) {
+        unique_ptr<ofPath>& path = _paths[i];
+        if (!path) {
+            path.reset(new ofPath());
+            int first = getFirstStroke(i);
+            int last = first + getNumStrokes(i);
+            for (int s = first; s < last; s++) {
+                const int16_t* v = getVertices(s);
+                int n = getNumVertices(s);
+                for (int j = 0; j < n; j++) {
+                    if (j == 0) {
+                        path->moveTo(v[0], v[1]);
+                    } else {
+                        path->lineTo(v[j * 2], v[j * 2 + 1]);
+                    }
+                }
+            }
+            path->setFilled(false);
+            path->setStrokeWidth(1.0f);
+            path->setStrokeColor(ofColor::white);
+        }
+        return *path;
+    }
+
+    void close() {
+#ifndef TARGET_WIN32
+        if (_map) {
+            munmap(_map, _mapSize);
+        }
+#else
+        _fileBuffer.clear();
+#endif
+        _owned.clear();
+        _paths.clear();
+        reset();
+    }
+
+private:
+    static const uint32_t VERSION = 1;
+
+    // n + 1 offsets from 0 up to total, never going back
+    static bool isValidTable(const uint32_t* offsets, uint32_t n, uint32_t total) {
+        if (offsets[0] != 0 || offsets[n] != total) {
+            return false;
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            if (offsets[i + 1] < offsets[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void reset() {
+        static const uint32_t zero = 0;
+        memset(&_header, 0, sizeof(_header));
+        _map = NULL;
+        _mapSize = 0;
+        _strokeOffsets = &zero;
+        _vertexOffsets = &zero;
+        _vertices = NULL;
+        _size = 0;
+    }
+
+    Header _header;
+    void* _map;
+    size_t _mapSize;
+#ifdef TARGET_WIN32
+    ofBuffer _fileBuffer;
+#endif
+    Builder _owned;
+
+    const uint32_t* _strokeOffsets;
+    const uint32_t* _vertexOffsets;
+    const int16_t* _vertices;
+    int _size;
+
+    vector<unique_ptr<ofPath> > _paths;
+};
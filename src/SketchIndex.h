@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SketchCorpus.h"
+
+// Drawings of a corpus by how busy they look and their shape, for picking
+// sketches that match the audio.
+//
+// build() reads every drawing's strokes once from the corpus arrays, without
+// making ofPaths: stroke count, vertex count (the simplified drawings keep a
+// vertex per turn, so it stands for complexity), ink length and bounding box.
+// Busyness is the mean rank of strokes, vertices and ink. Drawings are sorted
+// into LEVELS rows of equal size by busyness, and each row into SHAPES cells
+// of equal size from wide to tall, so no cell is empty while there are more
+// drawings than cells. pick() is a random drawing of one cell.
+class SketchIndex {
+public:
+    struct Features {
+        int strokes = 0;
+        int vertices = 0;
+        float ink = 0;          // total stroke length, in the 0..255 drawing space
+        float aspect = 1;       // bounding box width over height
+    };
+
+    static const int LEVELS = 8;
+    static const int SHAPES = 4;
+
+    void build(const SketchCorpus& corpus) {
+        int n = corpus.size();
+        _features.assign(n, Features());
+        for (int i = 0; i < n; i++) {
+            measure(corpus, i, _features[i]);
+        }
+
+        vector<float> busy(n, 0);
+        addRanks(busy, [this](int i) { return static_cast<float>(_features[i].strokes); });
+        addRanks(busy, [this](int i) { return static_cast<float>(_features[i].vertices); });
+        addRanks(busy, [this](int i) { return _features[i].ink; });
+
+        _order.resize(n);
+        for (int i = 0; i < n; i++) {
+            _order[i] = i;
+        }
+        stable_sort(_order.begin(), _order.end(), [&busy](int a, int b) { return busy[a] < busy[b]; });
+        for (int level = 0; level < LEVELS; level++) {
+            vector<int>::iterator first = _order.begin() + static_cast<int64_t>(level) * n / LEVELS;
+            vector<int>::iterator last = _order.begin() + static_cast<int64_t>(level + 1) * n / LEVELS;
+            stable_sort(first, last, [this](int a, int b) { return _features[a].aspect > _features[b].aspect; });
+            int rowStart = first - _order.begin();
+            int rowSize = last - first;
+            for (int shape = 0; shape < SHAPES; shape++) {
+                _cellStart[level * SHAPES + shape] = rowStart + shape * rowSize / SHAPES;
+            }
+        }
+        _cellStart[LEVELS * SHAPES] = n;
+    }
+
+    int size() const {
+        return _features.size();
+    }
+
+    const Features& getFeatures(int drawing) const {
+        return _features[drawing];
+    }
+
+    // A drawing from 0 sparse to 1 busy and from 0 wide to 1 tall, 0 when the corpus is empty
+    int pick(float level, float shape) const {
+        int n = _order.size();
+        if (n == 0) {
+            return 0;
+        }
+        int row = ofClamp(static_cast<int>(level * LEVELS), 0, LEVELS - 1);
+        int column = ofClamp(static_cast<int>(shape * SHAPES), 0, SHAPES - 1);
+        int cell = row * SHAPES + column;
+        int first = _cellStart[cell];
+        // fewer drawings than cells
+        int count = MAX(1, _cellStart[cell + 1] - first);
+        first = MIN(first, n - 1);
+        count = MIN(count, n - first);
+        return _order[first + static_cast<int>(ofRandom(count)) % count];
+    }
+
+private:
+    static void measure(const SketchCorpus& corpus, int drawing, Features& f) {
+        int16_t minX = numeric_limits<int16_t>::max(), minY = minX;
+        int16_t maxX = numeric_limits<int16_t>::min(), maxY = maxX;
+        int first = corpus.getFirstStroke(drawing);
+        f.strokes = corpus.getNumStrokes(drawing);
+        for (int s = first; s < first + f.strokes; s++) {
+            const int16_t* v = corpus.getVertices(s);
+            int n = corpus.getNumVertices(s);
+            f.vertices += n;
+            for (int j = 0; j < n; j++) {
+                minX = MIN(minX, v[j * 2]);
+                maxX = MAX(maxX, v[j * 2]);
+                minY = MIN(minY, v[j * 2 + 1]);
+                maxY = MAX(maxY, v[j * 2 + 1]);
+                if (j > 0) {
+                    f.ink += ofDist(v[j * 2 - 2], v[j * 2 - 1], v[j * 2], v[j * 2 + 1]);
+                }
+            }
+        }
+        if (f.vertices > 0) {
+            f.aspect = (maxX - minX + 1.0f) / (maxY - minY + 1.0f);
+        }
+    }
+
+    // adds each drawing's rank by key, ties in drawing order
+    template<class Key>
+    void addRanks(vector<float>& score, Key key) const {
+        vector<int> order(score.size());
+        for (int i = 0; i < order.size(); i++) {
+            order[i] = i;
+        }
+        stable_sort(order.begin(), order.end(), [&key](int a, int b) { return key(a) < key(b); });
+        for (int r = 0; r < order.size(); r++) {
+            score[order[r]] += r;
+        }
+    }
+
+    vector<Features> _features;
+    vector<int> _order;                         // drawings cell by cell
+    int _cellStart[LEVELS * SHAPES + 1] = {};
+};
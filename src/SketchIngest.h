@@ -0,0 +1,228 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SketchCorpus.h"
+#include "WorkerPool.h"
+
+// Streaming .ndjson reader used when there is no corpus file yet.
+//
+// The file is read in line-aligned chunks that are parsed on a WorkerPool and
+// merged back in file order. Lines are not validated as JSON: the scanner only
+// looks for the "drawing" key and reads its stroke arrays, skipping anything else.
+class SketchIngest {
+public:
+    static bool load(string filename, SketchCorpus::Builder& builder, int maxDrawings,
+                     WorkerPool& pool = WorkerPool::shared(), size_t chunkSize = 1 << 22) {
+        ifstream in(ofToDataPath(filename, true).c_str(), ios::binary);
+        if (!in) {
+            return false;
+        }
+        builder.clear();
+
+        size_t maxInFlight = pool.size() * 2;
+        deque<future<SketchCorpus::Builder> > pending;
+        string carry;
+        bool eof = false;
+
+        while (builder.size() < maxDrawings) {
+            while (!eof && pending.size() < maxInFlight) {
+                shared_ptr<string> text(new string());
+                text->swap(carry);
+                size_t offset = text->size();
+                text->resize(offset + chunkSize);
+                in.read(&(*text)[offset], chunkSize);
+                size_t read = in.gcount();
+                text->resize(offset + read);
+                eof = (read < chunkSize);
+
+                if (!eof) {
+                    size_t cut = text->rfind('\n');
+                    if (cut == string::npos) {
+                        // a single line longer than a chunk, keep reading
+                        carry.swap(*text);
+                        continue;
+                    }
+                    carry.assign(*text, cut + 1, string::npos);
+                    text->resize(cut + 1);
+                }
+                if (text->empty()) {
+                    continue;
+                }
+                pending.push_back(pool.submit([text, maxDrawings]() {
+                    SketchCorpus::Builder chunk;
+                    parseChunk(text->data(), text->data() + text->size(), chunk, maxDrawings);
+                    return chunk;
+                }));
+            }
+            if (pending.empty()) {
+                break;
+            }
+            SketchCorpus::Builder chunk = pending.front().get();
+            pending.pop_front();
+            builder.append(chunk, maxDrawings - builder.size());
+        }
+
+        // chunks past the limit are still running and only hold their own data
+        while (!pending.empty()) {
+            pending.front().wait();
+            pending.pop_front();
+        }
+        return true;
+    }
+
+    // Parses a QuickDraw .ndjson file and writes its corpus next to it.
+    static bool convert(string source, string target, int maxDrawings) {
+        SketchCorpus::Builder builder;
+        if (!load(source, builder, maxDrawings)) {
+            return false;
+        }
+        return SketchCorpus::save(target, builder, maxDrawings);
+    }
+
+    static void parseChunk(const char* p, const char* end, SketchCorpus::Builder& builder, int maxDrawings) {
+        vector<int> xs, ys;
+        while (p < end && builder.size() < maxDrawings) {
+            const char* eol = static_cast<const char*>(memchr(p, '\n', end - p));
+            if (eol == NULL) {
+                eol = end;
+            }
+            if (parseLine(p, eol, builder, xs, ys)) {
+                builder.endDrawing();
+            } else {
+                builder.discardDrawing();
+            }
+            p = eol + 1;
+        }
+    }
+
+    static bool parseLine(const char* p, const char* end, SketchCorpus::Builder& builder, vector<int>& xs, vector<int>& ys) {
+        static const char key[] = "\"drawing\"";
+        while (true) {
+            p = search(p, end, key, key + sizeof(key) - 1);
+            if (p == end) {
+                return false;
+            }
+            p += sizeof(key) - 1;
+            skipSpace(p, end);
+            if (p < end && *p == ':') {
+                break;
+            }
+        }
+        p++;
+        skipSpace(p, end);
+        if (!expect(p, end, '[')) {
+            return false;
+        }
+        skipSpace(p, end);
+        if (p < end && *p == ']') {
+            return true;
+        }
+
+        while (true) {
+            skipSpace(p, end);
+            if (!expect(p, end, '[')) {
+                return false;
+            }
+            if (!parseInts(p, end, xs) || !expect(p, end, ',') || !parseInts(p, end, ys)) {
+                return false;
+            }
+            // raw files carry a third array of timestamps
+            skipSpace(p, end);
+            while (p < end && *p == ',') {
+                p++;
+                if (!skipArray(p, end)) {
+                    return false;
+                }
+                skipSpace(p, end);
+            }
+            if (!expect(p, end, ']')) {
+                return false;
+            }
+
+            int n = MIN(xs.size(), ys.size());
+            for (int i = 0; i < n; i++) {
+                builder.addVertex(xs[i], ys[i]);
+            }
+            builder.endStroke();
+
+            skipSpace(p, end);
+            if (p < end && *p == ',') {
+                p++;
+            } else {
+                return expect(p, end, ']');
+            }
+        }
+    }
+
+private:
+    static bool skipArray(const char*& p, const char* end) {
+        if (!expect(p, end, '[')) {
+            return false;
+        }
+        const char* close = static_cast<const char*>(memchr(p, ']', end - p));
+        if (close == NULL) {
+            return false;
+        }
+        p = close + 1;
+        return true;
+    }
+
+    static void skipSpace(const char*& p, const char* end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) {
+            p++;
+        }
+    }
+
+    static bool expect(const char*& p, const char* end, char c) {
+        skipSpace(p, end);
+        if (p < end && *p == c) {
+            p++;
+            return true;
+        }
+        return false;
+    }
+
+    // [1, 2, 3] -> values; fractions are truncated like Json::Value::asInt
+    static bool parseInts(const char*& p, const char* end, vector<int>& values) {
+        values.clear();
+        if (!expect(p, end, '[')) {
+            return false;
+        }
+        skipSpace(p, end);
+        if (p < end && *p == ']') {
+            p++;
+            return true;
+        }
+        while (p < end) {
+            bool negative = false;
+            if (*p == '-') {
+                negative = true;
+                p++;
+            }
+            if (p >= end || *p < '0' || *p > '9') {
+                return false;
+            }
+            int v = 0;
+            while (p < end && *p >= '0' && *p <= '9') {
+                v = v * 10 + (*p - '0');
+                p++;
+            }
+            if (p < end && *p == '.') {
+                p++;
+                while (p < end && *p >= '0' && *p <= '9') {
+                    p++;
+                }
+            }
+            values.push_back(negative ? -v : v);
+
+            skipSpace(p, end);
+            if (p < end && *p == ',') {
+                p++;
+                skipSpace(p, end);
+            } else {
+                return expect(p, end, ']');
+            }
+        }
+        return false;
+    }
+};
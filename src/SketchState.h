@@ -1,22 +1,31 @@
 #include "ofxState.h"
-#include "ofxEasyFft.h"
-#include "ofxTween.h"
+#include "SharedData.h"
+#include "Clock.h"
+#include "PhaseTimer.h"
 #include "ofxJSON.h"
 #include "ofxBox2d.h"
+#include "SketchCorpus.h"
+#include "SketchIngest.h"
+#include "SketchIndex.h"
+#include "TileRenderer.h"
+#include "TileGrid.h"
+#include "SpectrumTerrain.h"
+#include "GroundBody.h"
+#include "CirclePool.h"
 
-static bool removeShapeOffScreen(shared_ptr<ofxBox2dBaseShape> shape) {
-    if (!ofRectangle(0, -200, ofGetWidth(), ofGetHeight() + 200).inside(shape.get()->getPosition())) {
+static bool removeShapeOffScreen(ofxBox2dBaseShape& shape) {
+    if (!ofRectangle(0, -200, ofGetWidth(), ofGetHeight() + 200).inside(shape.getPosition())) {
         return true;
     }
     return false;
 }
 
-class SketchState : public itg::ofxState<ofxEasyFft> {
+class SketchState : public itg::ofxState<SharedData> {
 public:
     class CircleData {
     public:
-        int index;
-        bool invert;
+        int index = 0;
+        bool invert = false;
     };
     
     enum Mode {
@@ -29,35 +38,42 @@ public:
         return "Sketches";
     }
     
+    void stateEnter() {
+        getSharedData().post.setEnabled(PostChain::Fxaa, true);
+        getSharedData().post.setEnabled(PostChain::Bloom, true);
+    }
+    
     void setup() {
         _maxSamples = 10000;
+        loadSettings("sketches.json");
 
-        loadDrawings("full-simplified-smiley face.ndjson", _smiles);
-        loadDrawings("full-simplified-dog.ndjson", _dogs);
-        loadDrawings("full-simplified-cat.ndjson", _cats);
+        loadDrawings("full-simplified-smiley face.ndjson", _smiles, _smileIndex);
+        loadDrawings("full-simplified-dog.ndjson", _dogs, _dogIndex);
+        loadDrawings("full-simplified-cat.ndjson", _cats, _catIndex);
+        
+        _catTiles.setup(_cats);
+        _dogTiles.setup(_dogs);
         
         setupTiles();
         setupPhysics();
         
         _invert = false;
         _mode = Cats;
-        
-        _post.init(ofGetWidth(), ofGetHeight());
-        _post.createPass<FxaaPass>()->setEnabled(true);
-        _post.createPass<BloomPass>()->setEnabled(true);
     }
     
     void update() {
-        vector<float> audio = getSharedData().getAudio();
-        float curVol = Util::calcVolume(audio);
-        _smoothedVol *= SMOOTH_FACTOR;
-        _smoothedVol += (1.0 - SMOOTH_FACTOR) * curVol;
-        _scaledVol = ofMap(_smoothedVol, 0.0, Util::getVolumeMax(), 0.0, 1.0, true);
+        AudioAnalyzer::Frame frame = getSharedData().analyzer.getFrame();
+        if (!frame) {
+            return;
+        }
+        _scaledVol = frame->scaledVolume;
+        _level = ofMap(_scaledVol, 0.25, 0.75, 0, 1, true);
+        _brightness = getBrightness(frame->bins);
         
         if (_mode == Cats || _mode == Dogs) {
             updateTiles();
         } else if (_mode == Smiles) {
-            updatePhysics();
+            updatePhysics(*frame);
         }
     }
     
@@ -93,69 +109,52 @@ public:
         }
     }
 private:
+    enum {
+        MAX_CIRCLES = 4096
+    };
+    
     void setupTiles() {
-        _nCols = 11;
-        _nRows = 8;
-        
-        for (int i = 0; i < _nCols * _nRows; i++) {
-            _indices.push_back(i);
-            ofxTween tween;
-            tween.setParameters(_linear, ofxTween::easeInOut, 0.0, 0.0, 0, 0);
-            _tweens.push_back(tween);
-        }
-        
-        _lastUpdate = static_cast<int>(ofGetElapsedTimef());
+        TileGrid::Settings settings;
+        settings.load("tiles.json");
+        _grid.setup(settings);
+        _lastUpdate = static_cast<int>(Clock::getElapsedTimef());
     }
     
     void updateTiles() {
-        int t = static_cast<int>(ofGetElapsedTimeMillis() / 30);
+        uint64_t now = Clock::getElapsedTimeMillis();
+        int t = static_cast<int>(now / 30);
         if (t != _lastUpdate) {
-            vector<int> list;
-            int n = ofMap(_scaledVol, 0.25, 0.75, 0, 3, true);
-            if (n != 0) {
-                pickIndices(list, n);
-                for (int i = 0; i < list.size(); i++) {
-                    _indices[list[i]] = ofRandom(_maxSamples);
-                    _tweens[list[i]].setParameters(_linear, ofxTween::easeInOut, 1.0, 0.0, 500, 0);
-                }
+            int n = ofMap(_scaledVol, 0.25, 0.75, 0, _grid.getSettings().changes, true);
+            const vector<int>& cells = _grid.sample(n);
+            const SketchIndex& index = (_mode == Cats ? _catIndex : _dogIndex);
+            for (int i = 0; i < cells.size(); i++) {
+                _grid.flash(cells[i], index.pick(_level, _brightness), now);
             }
             _lastUpdate = t;
         }
-        
-        for (int i = 0; i < _nRows * _nCols; i++) {
-            _tweens[i].update();
-        }
+        _grid.update(now);
     }
     
     void drawTiles() {
+        float angle = 15.0;
+        // laid out at 1280 px
+        ofVec2f offset(0, -300 * ofGetWidth() / 1280.0);
         ofPushMatrix();
-        ofRotate(15.0);
-        ofTranslate(0, -300);
+        ofRotate(angle);
+        ofTranslate(offset);
+
+        // the window corners taken back into the grid, for culling
+        ofRectangle visible(-offset, 0, 0);
+        ofVec2f corners[3] = {ofVec2f(ofGetWidth(), 0), ofVec2f(ofGetWidth(), ofGetHeight()), ofVec2f(0, ofGetHeight())};
+        for (int i = 0; i < 3; i++) {
+            visible.growToInclude(corners[i].getRotated(-angle) - offset);
+        }
         
         _invert ? ofBackground(255) : ofBackground(0);
-        for (int j = 0; j < _nRows; j++) {
-            for (int i = 0; i < _nCols; i++) {
-                int index = i + j * _nCols;
-                float v = _tweens[index].getTarget(0) * 255;
-                ofSetColor(_invert ? 255 - v : v);
-                ofDrawRectangle(128 * i, 128 * j + 16, 128, 128);
-                
-                float x = 128 * (i + 0.25);
-                float y = 128 * (j + 0.25) + 16;
-                ofPushMatrix();
-                ofTranslate(x, y);
-                ofScale(0.25, 0.25);
-                
-                if (_mode == Cats) {
-                    _cats[_indices[index]].setStrokeColor(ofColor(_invert ? v : 255 - v));
-                    _cats[_indices[index]].draw(0, 0);
-                } else {
-                    _dogs[_indices[index]].setStrokeColor(ofColor(_invert ? v : 255 - v));
-                    _dogs[_indices[index]].draw(0, 0);
-                }
-                ofPopMatrix();
-            }
-        }
+        TileRenderer& tiles = (_mode == Cats ? _catTiles : _dogTiles);
+        tiles.begin();
+        _grid.draw(tiles, ofGetWidth(), visible, _invert, Clock::getElapsedTimeMillis());
+        tiles.end();
         ofPopMatrix();
     }
     
@@ -166,54 +165,47 @@ private:
         _box2d.createGround();
         _box2d.setFPS(60.0);
         _box2d.registerGrabbing();
+        _circles.setup(_box2d.getWorld(), _maxCircles);
+        
+        _terrain.setup(256 / 8);
+        _terrain.update(vector<float>(), 256, 8, ofGetWidth(), ofGetHeight());
+        _groundBody.setup(_box2d.getWorld(), _terrain, ofGetWidth(), ofGetHeight());
         
         ofAddListener(_box2d.contactStartEvents, this, &SketchState::onContactStart);
         ofAddListener(_box2d.contactEndEvents, this, &SketchState::onContactEnd);
     }
     
-    void updatePhysics() {
-        ofRemove(_circles, removeShapeOffScreen);
-        _box2d.update();
-        
-        float prob = ofMap(_scaledVol, 0.25, 0.75, 0.0, 1.0, true);
+    void updatePhysics(const AnalysisFrame& frame) {
+        PhaseTimer::Scope scope(PhaseTimer::Physics);
+        _circles.despawnIf(removeShapeOffScreen);
+        {
+            PhaseTimer::Scope step("box2d.update");
+            _box2d.update();
+        }
         
         if (ofRandom(1.0) < 0.05) {
             float x = ofRandom(0, ofGetWidth());
             addCircle(x, -50, ofRandom(40, 60));
         }
         
-        ofxEasyFft& fft = getSharedData();
-        vector<float> buffer = fft.getBins();
-        Util::normalize(buffer);
-        
-        _ground.clear();
-        _groundLine.clear();
-        _groundLine.addVertex(0, ofGetHeight());
-        int n = MIN(256, buffer.size());
-        for (int i = 0; i < n; i+=8) {
-            float x1 = ofMap(i, 0, n, 0, ofGetWidth(), true);
-            float x2 = ofMap(i + 8, 0, n, 0, ofGetWidth(), true);
-            float y = ofMap(buffer[i], 0, 1, ofGetHeight(), ofGetHeight() * 0.5, true);
-            _groundLine.addVertex(x1, y);
-            _groundLine.addVertex(x2, y);
+        if (_terrain.update(frame.bins, 256, 8, ofGetWidth(), ofGetHeight())) {
+            _groundBody.update(_terrain, ofGetWidth(), ofGetHeight());
         }
-        _groundLine.addVertex(ofGetWidth(), ofGetHeight());
-        _ground.addVertexes(_groundLine);
-        _ground.create(_box2d.getWorld());
     }
     
     void drawPhysics() {
-        _post.begin();
+        getSharedData().post.begin();
         ofBackground(0);
         
         for (int i = 0; i < _circles.size(); i++) {
-            ofPoint p = _circles[i]->getPosition();
-            float r = _circles[i]->getRadius();
-            float rad = _circles[i]->getRotation();
+            ofxBox2dCircle& circle = _circles.getCircle(i);
+            ofPoint p = circle.getPosition();
+            float r = circle.getRadius();
+            float rad = circle.getRotation();
             
-            CircleData * data = (CircleData*)_circles[i].get()->getData();
-            bool invert = data->invert;
-            int index = data->index;
+            CircleData& data = _circles.getData(i);
+            bool invert = data.invert;
+            int index = data.index;
             float scale = r / 128.0;
             
             ofPushMatrix();
@@ -226,25 +218,20 @@ private:
             _smiles[index].setStrokeWidth(3.0f);
             _smiles[index].draw(-128, -128);
             ofPopMatrix();
-            
-            ofSetColor(64);
-            _tessellator.tessellateToMesh(_groundLine, OF_POLY_WINDING_ODD, _mesh);
-            _mesh.draw();
         }
-        _post.end();
+        
+        ofSetColor(64);
+        _terrain.draw();
+        getSharedData().post.end();
     }
     
     void addCircle(float x, float y, float r) {
-        shared_ptr<ofxBox2dCircle> c = shared_ptr<ofxBox2dCircle>(new ofxBox2dCircle);
-        c.get()->setPhysics(1.0, 0.7, 0.9);
-        c.get()->setup(_box2d.getWorld(), x, y, r);
-        
-        c.get()->setData(new CircleData());
-        CircleData* data = (CircleData*)c.get()->getData();
-        data->index = static_cast<int>(ofRandom(_maxSamples));
+        CircleData* data = _circles.spawn(x, y, r);
+        if (data == NULL) {
+            return;
+        }
+        data->index = _smileIndex.pick(_level, _brightness);
         data->invert = true;
-        
-        _circles.push_back(c);
     }
     
     void onContactStart(ofxBox2dContactArgs &e) {
@@ -258,11 +245,11 @@ private:
                 CircleData * bData = (CircleData*)e.b->GetBody()->GetUserData();
                 
                 if (aData) {
-                    aData->index = static_cast<int>(ofRandom(_maxSamples));
+                    aData->index = _smileIndex.pick(_level, _brightness);
                 }
                 
                 if (bData) {
-                    bData->index = static_cast<int>(ofRandom(_maxSamples));
+                    bData->index = _smileIndex.pick(_level, _brightness);
                 }
             }
         }
@@ -271,69 +258,63 @@ private:
     void onContactEnd(ofxBox2dContactArgs &e) {
     }
     
-    void loadDrawings(string filename, vector<ofPath>& container) {
-        ofFile file(filename);
-        ofBuffer buffer(file);
-        int n = 0;
-        container.clear();
-        for (ofBuffer::Line it = buffer.getLines().begin(), end = buffer.getLines().end(); it != end; ++it) {
-            string line = *it;
-            ofxJSONElement json;
-            bool ret = json.parse(line);
-            if (ret) {
-                auto strokes = json["drawing"];
-                
-                ofPath path;
-                for (int i = 0; i < strokes.size(); i++) {
-                    auto stroke = strokes[i];
-                    auto xVerts = strokes[i][0];
-                    auto yVerts = strokes[i][1];
-                    for (int j = 0; j < xVerts.size(); j++) {
-                        float x = xVerts[j].asInt();
-                        float y = yVerts[j].asInt();
-                        if (j == 0) {
-                            path.moveTo(x, y);
-                        } else {
-                            path.lineTo(x, y);
-                        }
-                    }
-                }
-                path.setFilled(false);
-                path.setStrokeWidth(1.0f);
-                path.setStrokeColor(ofColor::white);
-                
-                container.push_back(path);
-                n++;
-                if (n == _maxSamples) {
-                    break;
-                }
+    // Smiles circles, all made up front, 128 unless sketches.json says otherwise:
+    //   {"maxCircles": 128}
+    void loadSettings(string filename) {
+        _maxCircles = 128;
+        ofxJSONElement json;
+        if (ofFile::doesFileExist(filename) && json.open(filename)) {
+            if (json.isMember("maxCircles")) {
+                _maxCircles = ofClamp(json["maxCircles"].asInt(), 1, MAX_CIRCLES);
             }
         }
-        buffer.clear();
     }
     
-    void pickIndices(vector<int>& list, int n) {
-        list.clear();
-        for (int i = 0; i < _nRows * _nCols; i++) {
-            list.push_back(i);
+    void loadDrawings(string filename, SketchCorpus& container, SketchIndex& index) {
+        PhaseTimer::Scope scope("loadDrawings");
+        string corpus = SketchCorpus::corpusPathFor(filename);
+        bool converted = false;
+        if (!SketchCorpus::isUpToDate(filename, corpus, _maxSamples)) {
+            ofLogNotice("SketchState") << "converting " << filename << " to " << corpus;
+            SketchIngest::convert(filename, corpus, _maxSamples);
+            converted = true;
         }
-        
-        while (true) {
-            int k = list.size();
-            int index = static_cast<int>(ofRandom(k));
-            list.erase(list.begin() + index);
-            if (list.size() == n) {
-                break;
-            }
+        bool loaded = container.load(corpus, _maxSamples);
+        if (!loaded && !converted) {
+            ofLogWarning("SketchState") << corpus << " is unreadable, converting " << filename << " again";
+            SketchIngest::convert(filename, corpus, _maxSamples);
+            loaded = container.load(corpus, _maxSamples);
         }
+        if (!loaded) {
+            // corpus could not be written (read-only data folder etc.), keep it in memory
+            SketchCorpus::Builder builder;
+            SketchIngest::load(filename, builder, _maxSamples);
+            container.assign(builder);
+        }
+        index.build(container);
     }
-        
-    vector<ofPath> _cats, _dogs, _smiles;
-    int _nCols, _nRows, _maxSamples;
-    vector<int> _indices;
     
-    vector<ofxTween> _tweens;
-    ofxEasingLinear _linear;
+    // Spectral centroid of the values, 0 for all bass to 1 for a centroid a quarter of the way up
+    // or higher, which most music stays under. Low picks wide drawings, high picks tall ones.
+    float getBrightness(const vector<float>& bins) const {
+        float sum = 0;
+        float weighted = 0;
+        for (int i = 0; i < bins.size(); i++) {
+            sum += bins[i];
+            weighted += bins[i] * i;
+        }
+        if (sum <= 0) {
+            return 0.5;
+        }
+        return ofMap(weighted / sum / bins.size(), 0, 0.25, 0, 1, true);
+    }
+    
+    SketchCorpus _cats, _dogs, _smiles;
+    SketchIndex _catIndex, _dogIndex, _smileIndex;
+    int _maxSamples, _maxCircles;
+    
+    TileRenderer _catTiles, _dogTiles;
+    TileGrid _grid;
     
     int _lastUpdate;
     bool _invert;
@@ -341,14 +322,13 @@ private:
     
     Mode _mode;
     
-    float _smoothedVol = 0, _scaledVol = 0;
+    float _scaledVol = 0;
+    float _level = 0;           // _scaledVol over 0.25..0.75, where most music sits, as 0..1
+    float _brightness = 0.5;
     
     ofxBox2d _box2d;
-    vector<shared_ptr<ofxBox2dCircle> > _circles;
-    ofxBox2dEdge _ground;
-    ofPolyline _groundLine;
-    ofTessellator _tessellator;
-    ofMesh _mesh;
+    CirclePool<CircleData> _circles;
+    SpectrumTerrain _terrain;
+    GroundBody _groundBody;
     
-    ofxPostProcessing _post;
 };
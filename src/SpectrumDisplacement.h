@@ -0,0 +1,153 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Outline displaced along its normals by the spectrum, on the GPU.
+//
+// SpectrumDisplacement keeps the latest bins in a one-row float texture and a
+// vertex shader that looks up each vertex's bin there. DisplacedShape holds
+// the static part: base positions, normals, the bin each vertex reads, and a
+// fan from the centroid, all uploaded once. Per frame only the bins go up, so
+// the CPU cost does not depend on how many vertices a shape has.
+class SpectrumDisplacement {
+public:
+    bool setup(int binCount) {
+        _programmable = ofIsGLProgrammableRenderer();
+        _binCount = binCount;
+        _texture.allocate(binCount, 1, _programmable ? GL_R32F : GL_LUMINANCE32F_ARB, false);
+        _texture.setTextureMinMagFilter(GL_LINEAR, GL_LINEAR);
+        _texture.setTextureWrap(GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE);
+        _loaded = setupShader();
+        return _loaded;
+    }
+
+    bool isLoaded() const {
+        return _loaded;
+    }
+
+    void update(const vector<float>& bins) {
+        int n = MIN(_binCount, static_cast<int>(bins.size()));
+        _texture.loadData(bins.data(), n, 1, _programmable ? GL_RED : GL_LUMINANCE);
+    }
+
+    // displacement in pixels for a bin value of 1
+    void begin(float gain) {
+        _shader.begin();
+        _shader.setUniformTexture("spectrum", _texture, 0);
+        _shader.setUniform1f("binCount", _binCount);
+        _shader.setUniform1f("gain", gain);
+    }
+
+    void end() {
+        _shader.end();
+    }
+
+private:
+    bool setupShader() {
+        string vertex, fragment;
+        if (_programmable) {
+            vertex = R"(#version 150
+                uniform mat4 modelViewProjectionMatrix;
+                uniform vec4 globalColor;
+                uniform sampler2D spectrum;
+                uniform float binCount;
+                uniform float gain;
+                in vec4 position;
+                in vec3 normal;
+                in vec2 texcoord;   // x: bin, fractional bins interpolate
+                out vec4 colorVarying;
+
+                void main() {
+                    float d = texture(spectrum, vec2((texcoord.x + 0.5) / binCount, 0.5)).r * gain;
+                    gl_Position = modelViewProjectionMatrix * vec4(position.xy + normal.xy * d, 0.0, 1.0);
+                    colorVarying = globalColor;
+                }
+            )";
+            fragment = R"(#version 150
+                in vec4 colorVarying;
+                out vec4 outputColor;
+
+                void main() {
+                    outputColor = colorVarying;
+                }
+            )";
+        } else {
+            vertex = R"(#version 120
+                uniform sampler2D spectrum;
+                uniform float binCount;
+                uniform float gain;
+
+                void main() {
+                    float d = texture2DLod(spectrum, vec2((gl_MultiTexCoord0.x + 0.5) / binCount, 0.5), 0.0).r * gain;
+                    gl_Position = gl_ModelViewProjectionMatrix * vec4(gl_Vertex.xy + gl_Normal.xy * d, 0.0, 1.0);
+                    gl_FrontColor = gl_Color;
+                }
+            )";
+            fragment = R"(#version 120
+                void main() {
+                    gl_FragColor = gl_Color;
+                }
+            )";
+        }
+        _shader.setupShaderFromSource(GL_VERTEX_SHADER, vertex);
+        _shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragment);
+        if (_programmable) {
+            _shader.bindDefaults();
+        }
+        return _shader.linkProgram();
+    }
+
+    bool _programmable = false;
+    bool _loaded = false;
+    int _binCount = 0;
+    ofTexture _texture;
+    ofShader _shader;
+};
+
+class DisplacedShape {
+public:
+    // outline is closed, convex around its centroid; its points read bins firstBin .. firstBin + nBins
+    void setup(const ofPolyline& outline, float firstBin, float nBins) {
+        _nPoints = outline.size();
+        vector<ofVec3f> positions(_nPoints + 1), normals(_nPoints + 1);
+        vector<ofVec2f> bins(_nPoints + 1);
+        ofVec3f centroid;
+        for (int j = 0; j < _nPoints; j++) {
+            positions[1 + j] = outline[j];
+            normals[1 + j] = outline.getNormalAtIndex(j);
+            bins[1 + j].set(firstBin + nBins * j / _nPoints, 0);
+            centroid += outline[j];
+        }
+        // the centre stays put
+        positions[0] = centroid / MAX(_nPoints, 1);
+        bins[0].set(firstBin, 0);
+
+        vector<ofIndexType> indices;
+        for (int j = 0; j < _nPoints; j++) {
+            indices.push_back(0);
+            indices.push_back(1 + j);
+            indices.push_back(1 + (j + 1) % _nPoints);
+        }
+        _vbo.setVertexData(positions.data(), positions.size(), GL_STATIC_DRAW);
+        _vbo.setNormalData(normals.data(), normals.size(), GL_STATIC_DRAW);
+        _vbo.setTexCoordData(bins.data(), bins.size(), GL_STATIC_DRAW);
+        _vbo.setIndexData(indices.data(), indices.size(), GL_STATIC_DRAW);
+    }
+
+    int getNumPoints() const {
+        return _nPoints;
+    }
+
+    // between SpectrumDisplacement::begin() and end()
+    void drawFill() const {
+        _vbo.drawElements(GL_TRIANGLES, _nPoints * 3);
+    }
+
+    void drawOutline() const {
+        _vbo.draw(GL_LINE_LOOP, 1, _nPoints);
+    }
+
+private:
+    int _nPoints = 0;
+    ofVbo _vbo;
+};
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Stepped ground whose column heights follow the spectrum.
+//
+// Each column is a quad in a persistent vbo with a fixed index buffer. Only the
+// top vertices move, and the vbo is only touched when a height actually changed.
+class SpectrumTerrain {
+public:
+    void setup(int nColumns) {
+        _nColumns = nColumns;
+        _heights.assign(nColumns, -1);
+        _vertices.assign(nColumns * 4, ofVec3f());
+
+        vector<ofIndexType> indices;
+        for (int i = 0; i < nColumns; i++) {
+            int base = i * 4;
+            indices.push_back(base);
+            indices.push_back(base + 1);
+            indices.push_back(base + 2);
+            indices.push_back(base + 2);
+            indices.push_back(base + 1);
+            indices.push_back(base + 3);
+        }
+        _vbo.setVertexData(_vertices.data(), _vertices.size(), GL_DYNAMIC_DRAW);
+        _vbo.setIndexData(indices.data(), indices.size(), GL_STATIC_DRAW);
+        _width = _height = 0;
+    }
+
+    // Samples every stride-th of the first nBins bins. Returns true if the shape changed.
+    bool update(const vector<float>& bins, int nBins, int stride, float width, float height) {
+        bool resized = (width != _width || height != _height);
+        bool changed = resized;
+        nBins = MIN(nBins, static_cast<int>(bins.size()));
+
+        for (int i = 0; i < _nColumns; i++) {
+            int bin = i * stride;
+            float v = (bin < nBins && !isnan(bins[bin])) ? bins[bin] : 0;
+            float y = ofMap(v, 0, 1, height, height * 0.5, true);
+            if (y != _heights[i] || resized) {
+                float x1 = ofMap(bin, 0, nBins, 0, width, true);
+                float x2 = ofMap(bin + stride, 0, nBins, 0, width, true);
+                ofVec3f* quad = &_vertices[i * 4];
+                quad[0].set(x1, y);
+                quad[1].set(x1, height);
+                quad[2].set(x2, y);
+                quad[3].set(x2, height);
+                _heights[i] = y;
+                changed = true;
+            }
+        }
+
+        if (changed) {
+            _width = width;
+            _height = height;
+            _vbo.updateVertexData(_vertices.data(), _vertices.size());
+        }
+        return changed;
+    }
+
+    float getHeight(int column) const {
+        return _heights[column];
+    }
+
+    float getLeft(int column) const {
+        return _vertices[column * 4].x;
+    }
+
+    float getRight(int column) const {
+        return _vertices[column * 4 + 2].x;
+    }
+
+    int getNumColumns() const {
+        return _nColumns;
+    }
+
+    void draw() const {
+        _vbo.drawElements(GL_TRIANGLES, _nColumns * 6);
+    }
+
+private:
+    int _nColumns = 0;
+    float _width = 0, _height = 0;
+    vector<float> _heights;
+    vector<ofVec3f> _vertices;
+    ofVbo _vbo;
+};
@@ -0,0 +1,269 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxJSON.h"
+#include "ofxStateMachine.h"
+#include "SharedData.h"
+#include "ShapeState.h"
+#include "SketchState.h"
+#include "WavFile.h"
+#include "PhaseTimer.h"
+#include "Clock.h"
+
+// Frame times of every state and mode, run as:
+//
+//   mophV --bench states [--frames N] [--warmup N] [--size WxH] [--wav file.wav]
+//                        [--out bench-states.json] [--baseline old.json]
+//
+// Each mode runs from a fixed ofRandom seed on a fixed clock at 60 fps, fed
+// either a WAV file or a synthetic signal that is the same on every run, and
+// renders into an fbo in a hidden window. Per phase it reports p50 and p99 in
+// milliseconds, plus the whole frame up to glFinish. The results go to a
+// JSON file; with --baseline, p50s more than 10% slower than that file are
+// reported as regressions and the exit code is 1.
+class StateBenchmark : public ofBaseApp {
+public:
+    struct Settings {
+        int frames = 600;
+        int warmup = 60;
+        int width = 1280;
+        int height = 800;
+        string wav;
+        string out = "bench-states.json";
+        string baseline;
+
+        bool parse(const vector<string>& args) {
+            for (int i = 0; i < args.size(); i++) {
+                bool hasValue = (i + 1 < args.size());
+                if (args[i] == "--frames" && hasValue) {
+                    frames = ofToInt(args[++i]);
+                } else if (args[i] == "--warmup" && hasValue) {
+                    warmup = ofToInt(args[++i]);
+                } else if (args[i] == "--size" && hasValue) {
+                    vector<string> size = ofSplitString(args[++i], "x");
+                    width = (size.size() == 2 ? ofToInt(size[0]) : 0);
+                    height = (size.size() == 2 ? ofToInt(size[1]) : 0);
+                } else if (args[i] == "--wav" && hasValue) {
+                    wav = args[++i];
+                } else if (args[i] == "--out" && hasValue) {
+                    out = args[++i];
+                } else if (args[i] == "--baseline" && hasValue) {
+                    baseline = args[++i];
+                } else {
+                    cerr << "unknown argument " << args[i] << endl;
+                    return false;
+                }
+            }
+            return frames > 0 && warmup >= 0 && width > 0 && height > 0;
+        }
+    };
+
+    static int run(const vector<string>& args) {
+        Settings settings;
+        if (!settings.parse(args)) {
+            cerr << "usage: mophV --bench states [--frames N] [--warmup N] [--size WxH] [--wav file.wav] [--out file.json] [--baseline file.json]" << endl;
+            return 1;
+        }
+        ofGLFWWindowSettings window;
+        window.setGLVersion(2, 1);
+        window.width = settings.width;
+        window.height = settings.height;
+        window.visible = false;
+        ofCreateWindow(window);
+        return ofRunApp(new StateBenchmark(settings));
+    }
+
+    explicit StateBenchmark(const Settings& settings) : _settings(settings) {
+    }
+
+    // the whole run happens here, the main loop only exits
+    void setup() {
+        ofExit(runAll());
+    }
+
+private:
+    static const int FPS = 60;
+    static const int SAMPLE_RATE = 44100;
+
+    int runAll() {
+        if (!_settings.wav.empty() && !_wav.load(_settings.wav)) {
+            return 1;
+        }
+        AnalysisConfig config;
+        config.load("analysis.json");
+        config.sampleRate = (_wav.getSampleRate() > 0 ? _wav.getSampleRate() : SAMPLE_RATE);
+        _machine.disableAppEvents();
+        _machine.getSharedData().analyzer.setupOffline(config);
+        _machine.getSharedData().post.setup(ofGetWidth(), ofGetHeight());
+        _fbo.allocate(ofGetWidth(), ofGetHeight(), GL_RGBA);
+        ofSetVerticalSync(false);
+        PhaseTimer::setEnabled(true);
+
+        ofxJSONElement json;
+        json["frames"] = _settings.frames;
+        json["warmup"] = _settings.warmup;
+        json["width"] = ofGetWidth();
+        json["height"] = ofGetHeight();
+        json["audio"] = (_settings.wav.empty() ? "synthetic" : _settings.wav);
+
+        const char* shapeModes[] = {"CircleSingle", "CircleMulti", "Polygon", "Typography"};
+        const char* sketchModes[] = {"Cats", "Dogs", "Smiles"};
+        StatePtr shapes = _machine.addState<ShapeState>();
+        StatePtr sketches = _machine.addState<SketchState>();
+        for (int m = 0; m < 4; m++) {
+            json["results"].append(runMode(shapes, shapeModes[m], m > 0));
+        }
+        for (int m = 0; m < 3; m++) {
+            json["results"].append(runMode(sketches, sketchModes[m], m > 0));
+        }
+
+        if (!json.save(_settings.out, true)) {
+            ofLogError("StateBenchmark") << "could not write " << _settings.out;
+            return 1;
+        }
+        cout << "results in " << _settings.out << endl;
+        return (_settings.baseline.empty() ? 0 : compare(json));
+    }
+
+    typedef shared_ptr<itg::ofxState<SharedData> > StatePtr;
+
+    // the mode after the state's current one when next, as OF_KEY_RIGHT would
+    ofxJSONElement runMode(StatePtr state, string mode, bool next) {
+        ofSeedRandom(0);
+        _audioFrame = 0;
+        // the fades and moves a mode starts on entry are timed from frame 0
+        Clock::setFixed(0);
+        if (next) {
+            state->keyPressed(OF_KEY_RIGHT);
+        } else {
+            state->stateEnter();
+        }
+
+        vector<vector<double> > samples(PHASE_COUNT + 1);
+        double ms[PHASE_COUNT];
+        for (int f = 0; f < _settings.warmup + _settings.frames; f++) {
+            uint64_t start = PhaseTimer::now();
+            Clock::setFixed(static_cast<double>(f) / FPS);
+            feedAudio();
+            state->update();
+            {
+                PhaseTimer::Scope draw(PhaseTimer::Draw);
+                _fbo.begin();
+                ofClear(0, 255);
+                state->draw();
+                _fbo.end();
+            }
+            glFinish();
+            double frameMs = (PhaseTimer::now() - start) / 1e6;
+
+            PhaseTimer::collect(ms);
+            if (f < _settings.warmup) {
+                continue;
+            }
+            // draw submission without the post-processing inside it
+            ms[PhaseTimer::Draw] = MAX(0.0, ms[PhaseTimer::Draw] - ms[PhaseTimer::Post]);
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                samples[p].push_back(ms[p]);
+            }
+            samples[PHASE_COUNT].push_back(frameMs);
+        }
+
+        ofxJSONElement result;
+        result["state"] = state->getName();
+        result["mode"] = mode;
+        cout << state->getName() << " / " << mode << ":";
+        for (int p = 0; p <= PHASE_COUNT; p++) {
+            string name = (p < PHASE_COUNT ? PhaseTimer::getName(static_cast<PhaseTimer::Phase>(p)) : "frame");
+            double p50 = percentile(samples[p], 0.5);
+            double p99 = percentile(samples[p], 0.99);
+            result["phases"][name]["p50"] = p50;
+            result["phases"][name]["p99"] = p99;
+            cout << " " << name << " " << ofToString(p50, 3) << "/" << ofToString(p99, 3);
+        }
+        cout << " ms (p50/p99)" << endl;
+        return result;
+    }
+
+    // one frame of audio: the WAV file looped, or the synthetic signal
+    void feedAudio() {
+        AudioAnalyzer& analyzer = _machine.getSharedData().analyzer;
+        int rate = analyzer.getConfig().sampleRate;
+        int64_t from = static_cast<int64_t>(_audioFrame) * rate / FPS;
+        int64_t to = static_cast<int64_t>(_audioFrame + 1) * rate / FPS;
+        _audioFrame++;
+        _audio.resize(to - from);
+        const vector<float>& wav = _wav.getSamples();
+        for (int i = 0; i < _audio.size(); i++) {
+            int64_t n = from + i;
+            _audio[i] = (!wav.empty() ? wav[n % wav.size()] : synthetic(n, rate));
+        }
+        analyzer.process(_audio.data(), _audio.size());
+    }
+
+    // A kick every half second over a slow chord sweep and a little noise, a pure function of n
+    static float synthetic(int64_t n, int rate) {
+        double t = static_cast<double>(n) / rate;
+        double beat = fmod(t, 0.5);
+        double kick = exp(-beat * 20.0) * sin(TWO_PI * 55.0 * beat);
+        double sweep = 0;
+        for (int k = 1; k <= 3; k++) {
+            sweep += sin(TWO_PI * (220.0 * k + 110.0 * sin(t * 0.5)) * t) / (k * 3.0);
+        }
+        // integer hash instead of ofRandom, so the noise does not move the seeded sequence
+        uint32_t h = static_cast<uint32_t>(n) * 2654435761u;
+        h ^= h >> 15;
+        double noise = (h & 0xffff) / 32768.0 - 1.0;
+        return 0.6 * kick + 0.3 * sweep + 0.05 * noise;
+    }
+
+    static double percentile(vector<double> values, double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        sort(values.begin(), values.end());
+        int i = ceil(p * values.size()) - 1;
+        return values[MIN(MAX(i, 0), static_cast<int>(values.size()) - 1)];
+    }
+
+    // p50s over 10% (and 0.05 ms) slower than the baseline's are regressions
+    int compare(ofxJSONElement& current) {
+        ofxJSONElement baseline;
+        if (!baseline.open(_settings.baseline)) {
+            ofLogError("StateBenchmark") << "could not read " << _settings.baseline;
+            return 1;
+        }
+        int regressions = 0;
+        for (int i = 0; i < current["results"].size(); i++) {
+            ofxJSONElement now = current["results"][i];
+            for (int j = 0; j < baseline["results"].size(); j++) {
+                ofxJSONElement before = baseline["results"][j];
+                if (before["state"].asString() != now["state"].asString() || before["mode"].asString() != now["mode"].asString()) {
+                    continue;
+                }
+                for (int p = 0; p <= PHASE_COUNT; p++) {
+                    string name = (p < PHASE_COUNT ? PhaseTimer::getName(static_cast<PhaseTimer::Phase>(p)) : "frame");
+                    double a = before["phases"][name]["p50"].asDouble();
+                    double b = now["phases"][name]["p50"].asDouble();
+                    if (b > a * 1.1 && b - a > 0.05) {
+                        cout << "REGRESSION " << now["state"].asString() << " / " << now["mode"].asString() << " " << name
+                             << ": " << ofToString(a, 3) << " -> " << ofToString(b, 3) << " ms" << endl;
+                        regressions++;
+                    }
+                }
+            }
+        }
+        cout << regressions << " regressions against " << _settings.baseline << endl;
+        return (regressions == 0 ? 0 : 1);
+    }
+
+    enum {
+        PHASE_COUNT = PhaseTimer::PHASE_COUNT
+    };
+
+    Settings _settings;
+    itg::ofxStateMachine<SharedData> _machine;
+    WavFile _wav;
+    vector<float> _audio;
+    int _audioFrame = 0;
+    ofFbo _fbo;
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxStateMachine.h"
+#include "SharedData.h"
+#include "Clock.h"
+
+// Crossfades between the states of an ofxStateMachine instead of cutting.
+//
+// ofApp turns off the machine's own update, draw and key events and calls
+// this instead. Between cues only the current state runs and draws straight
+// to the screen. During a fade the outgoing and the incoming state both
+// update and each draws into its own framebuffer, which are blended over the
+// fade. The framebuffers are allocated up front, and warmUp() draws every
+// mode of every state once offscreen at startup so their shaders, buffers and
+// textures are already on the GPU when the first cue comes.
+class StateTransition {
+public:
+    typedef shared_ptr<itg::ofxState<SharedData> > StatePtr;
+
+    void setup(itg::ofxStateMachine<SharedData>& machine, float fadeSeconds) {
+        _machine = &machine;
+        _fadeSeconds = fadeSeconds;
+        allocate(ofGetWidth(), ofGetHeight());
+    }
+
+    // nModes is how many OF_KEY_RIGHT presses take the state back to the mode it starts in
+    void add(StatePtr state, int nModes = 1) {
+        _names.push_back(state->getName());
+        _states.push_back(state);
+        _modes.push_back(MAX(1, nModes));
+    }
+
+    // Once, before the first start(). Steps each state through all its modes and
+    // back to the first, drawing every one, so no mode uploads on its first cue.
+    void warmUp() {
+        for (int i = 0; i < _states.size(); i++) {
+            for (int m = 0; m < _modes[i]; m++) {
+                if (m > 0) {
+                    _states[i]->keyPressed(OF_KEY_RIGHT);
+                }
+                drawInto(_incoming, i);
+            }
+            if (_modes[i] > 1) {
+                _states[i]->keyPressed(OF_KEY_RIGHT);
+            }
+        }
+    }
+
+    // cut, for the first state
+    void start(string name) {
+        _to = find(name);
+        _from = -1;
+        _machine->changeState(name);
+    }
+
+    // A fade already running jumps to its end first
+    void fadeTo(string name) {
+        int to = find(name);
+        if (to < 0 || to == _to) {
+            return;
+        }
+        _from = _to;
+        _to = to;
+        _fadeStart = Clock::getElapsedTimef();
+        // stateExit and stateEnter run now
+        _machine->changeState(name);
+    }
+
+    // to the current state, the incoming one during a fade
+    void keyPressed(int key) {
+        if (_to >= 0) {
+            _states[_to]->keyPressed(key);
+        }
+    }
+
+    void keyReleased(int key) {
+        if (_to >= 0) {
+            _states[_to]->keyReleased(key);
+        }
+    }
+
+    // null when there is no state of that name
+    StatePtr getState(string name) const {
+        int i = find(name);
+        return (i >= 0 ? _states[i] : StatePtr());
+    }
+
+    bool isFading() const {
+        return _from >= 0;
+    }
+
+    void update() {
+        if (isFading() && getProgress() >= 1.0) {
+            _from = -1;
+        }
+        if (isFading()) {
+            _states[_from]->update();
+        }
+        if (_to >= 0) {
+            _states[_to]->update();
+        }
+    }
+
+    void draw() {
+        if (_to < 0) {
+            return;
+        }
+        if (!isFading()) {
+            _states[_to]->draw();
+            return;
+        }
+        allocate(ofGetWidth(), ofGetHeight());
+        drawInto(_outgoing, _from);
+        drawInto(_incoming, _to);
+
+        ofPushStyle();
+        ofEnableAlphaBlending();
+        ofSetColor(255);
+        _outgoing.draw(0, 0);
+        ofSetColor(255, 255 * getProgress());
+        _incoming.draw(0, 0);
+        ofPopStyle();
+    }
+
+private:
+    int find(string name) const {
+        for (int i = 0; i < _names.size(); i++) {
+            if (_names[i] == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    float getProgress() const {
+        return (_fadeSeconds > 0 ? ofClamp((Clock::getElapsedTimef() - _fadeStart) / _fadeSeconds, 0, 1) : 1);
+    }
+
+    void drawInto(ofFbo& fbo, int state) {
+        fbo.begin();
+        ofClear(0, 255);
+        ofSetColor(255);
+        _states[state]->draw();
+        fbo.end();
+    }
+
+    // only when the window size changed
+    void allocate(int width, int height) {
+        if (_incoming.isAllocated() && _incoming.getWidth() == width && _incoming.getHeight() == height) {
+            return;
+        }
+        _outgoing.allocate(width, height, GL_RGBA);
+        _incoming.allocate(width, height, GL_RGBA);
+    }
+
+    itg::ofxStateMachine<SharedData>* _machine = NULL;
+    vector<string> _names;
+    vector<StatePtr> _states;
+    vector<int> _modes;
+    int _from = -1;
+    int _to = -1;
+    float _fadeStart = 0;
+    float _fadeSeconds = 0;
+    ofFbo _outgoing, _incoming;
+};
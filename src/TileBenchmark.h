@@ -0,0 +1,152 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SketchCorpus.h"
+#include "SketchIngest.h"
+#include "TileRenderer.h"
+#include "TileGrid.h"
+#include "PhaseTimer.h"
+
+// Frame times of the sketch tile wall at several grid sizes, run as:
+//
+//   mophV --bench tiles [--frames N] [--warmup N] [--size WxH] [--ndjson file.ndjson]
+//
+// Opens the same GL 2.1 context as the app, so the tiles take the baked
+// glMultiDrawArrays path, and draws each grid into an fbo the way
+// SketchState does: every sixth frame a few cells flash and then fade. Per
+// grid it reports p50 and p99 in milliseconds of submitting the tiles and of
+// the whole frame up to glFinish.
+class TileBenchmark : public ofBaseApp {
+public:
+    struct Settings {
+        int frames = 600;
+        int warmup = 60;
+        int width = 1280;
+        int height = 800;
+        string ndjson = "full-simplified-cat.ndjson";
+
+        bool parse(const vector<string>& args) {
+            for (int i = 0; i < args.size(); i++) {
+                bool hasValue = (i + 1 < args.size());
+                if (args[i] == "--frames" && hasValue) {
+                    frames = ofToInt(args[++i]);
+                } else if (args[i] == "--warmup" && hasValue) {
+                    warmup = ofToInt(args[++i]);
+                } else if (args[i] == "--size" && hasValue) {
+                    vector<string> size = ofSplitString(args[++i], "x");
+                    width = (size.size() == 2 ? ofToInt(size[0]) : 0);
+                    height = (size.size() == 2 ? ofToInt(size[1]) : 0);
+                } else if (args[i] == "--ndjson" && hasValue) {
+                    ndjson = args[++i];
+                } else {
+                    cerr << "unknown argument " << args[i] << endl;
+                    return false;
+                }
+            }
+            return frames > 0 && warmup >= 0 && width > 0 && height > 0;
+        }
+    };
+
+    static int run(const vector<string>& args) {
+        Settings settings;
+        if (!settings.parse(args)) {
+            cerr << "usage: mophV --bench tiles [--frames N] [--warmup N] [--size WxH] [--ndjson file.ndjson]" << endl;
+            return 1;
+        }
+        ofGLFWWindowSettings window;
+        window.setGLVersion(2, 1);
+        window.width = settings.width;
+        window.height = settings.height;
+        window.visible = false;
+        ofCreateWindow(window);
+        return ofRunApp(new TileBenchmark(settings));
+    }
+
+    explicit TileBenchmark(const Settings& settings) : _settings(settings) {
+    }
+
+    // the whole run happens here, the main loop only exits
+    void setup() {
+        ofExit(runAll());
+    }
+
+private:
+    enum {
+        MAX_SAMPLES = 10000
+    };
+
+    int runAll() {
+        string corpus = SketchCorpus::corpusPathFor(_settings.ndjson);
+        if (!SketchCorpus::isUpToDate(_settings.ndjson, corpus, MAX_SAMPLES)) {
+            SketchIngest::convert(_settings.ndjson, corpus, MAX_SAMPLES);
+        }
+        if (!_corpus.load(corpus, MAX_SAMPLES)) {
+            ofLogError("TileBenchmark") << "could not load " << corpus;
+            return 1;
+        }
+        _tiles.setup(_corpus);
+        _fbo.allocate(ofGetWidth(), ofGetHeight(), GL_RGBA);
+        ofSetVerticalSync(false);
+
+        const int sides[][2] = {{11, 8}, {32, 24}, {100, 100}};
+        for (int i = 0; i < 3; i++) {
+            runGrid(sides[i][0], sides[i][1]);
+        }
+        return 0;
+    }
+
+    void runGrid(int columns, int rows) {
+        ofSeedRandom(0);
+        TileGrid::Settings settings;
+        settings.columns = columns;
+        settings.rows = rows;
+        _grid.setup(settings);
+
+        vector<double> submitMs, frameMs;
+        for (int f = 0; f < _settings.warmup + _settings.frames; f++) {
+            uint64_t now = static_cast<uint64_t>(f) * 1000 / 60;
+            if (f % 6 == 0) {
+                const vector<int>& cells = _grid.sample(_grid.getSettings().changes);
+                for (int i = 0; i < cells.size(); i++) {
+                    _grid.flash(cells[i], static_cast<int>(ofRandom(_corpus.size())), now);
+                }
+            }
+            _grid.update(now);
+
+            uint64_t start = PhaseTimer::now();
+            _fbo.begin();
+            ofClear(0, 255);
+            _tiles.begin();
+            _grid.draw(_tiles, ofGetWidth(), ofRectangle(0, 0, ofGetWidth(), ofGetHeight()), false, now);
+            _tiles.end();
+            uint64_t submitted = PhaseTimer::now();
+            _fbo.end();
+            glFinish();
+            uint64_t finished = PhaseTimer::now();
+
+            if (f >= _settings.warmup) {
+                submitMs.push_back((submitted - start) / 1e6);
+                frameMs.push_back((finished - start) / 1e6);
+            }
+        }
+        cout << columns << "x" << rows << ":"
+             << " submit " << ofToString(percentile(submitMs, 0.5), 3) << "/" << ofToString(percentile(submitMs, 0.99), 3)
+             << " frame " << ofToString(percentile(frameMs, 0.5), 3) << "/" << ofToString(percentile(frameMs, 0.99), 3)
+             << " ms (p50/p99)" << endl;
+    }
+
+    static double percentile(vector<double> values, double p) {
+        if (values.empty()) {
+            return 0;
+        }
+        sort(values.begin(), values.end());
+        int i = ceil(p * values.size()) - 1;
+        return values[MIN(MAX(i, 0), static_cast<int>(values.size()) - 1)];
+    }
+
+    Settings _settings;
+    SketchCorpus _corpus;
+    TileRenderer _tiles;
+    TileGrid _grid;
+    ofFbo _fbo;
+};
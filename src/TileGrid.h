@@ -0,0 +1,193 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ofxJSON.h"
+#include "TileRenderer.h"
+
+// Cells of the sketch tile wall: which drawing each shows and how far its
+// flash has faded.
+//
+// The grid size comes from data/tiles.json when present:
+//
+//   {
+//     "columns": 11,
+//     "rows": 8,
+//     "changes": 3,        most cells flashed per tick, at full volume
+//     "fadeMs": 500,       flash back to the idle colours, linear
+//     "minTileSize": 32    px at 1280, larger grids run off the window
+//   }
+//
+// Per tick sample() is a partial Fisher-Yates shuffle of a permutation kept
+// between ticks, so it costs the cells it returns, not the grid. Only cells
+// that are fading are in the active set, which update() walks and compacts.
+// Tiles scale with the window width, 128 px for 11 columns at 1280, but
+// never below minTileSize, and draw() only submits the cells inside the
+// visible rectangle. So however large the grid, a frame draws at most about
+// a window's worth of tiles.
+class TileGrid {
+public:
+    struct Settings {
+        int columns = 11;
+        int rows = 8;
+        int changes = 3;
+        int fadeMs = 500;
+        int minTileSize = 32;
+
+        bool load(string filename) {
+            ofxJSONElement json;
+            if (!ofFile::doesFileExist(filename) || !json.open(filename)) {
+                return false;
+            }
+            if (json.isMember("columns")) {
+                columns = json["columns"].asInt();
+            }
+            if (json.isMember("rows")) {
+                rows = json["rows"].asInt();
+            }
+            if (json.isMember("changes")) {
+                changes = json["changes"].asInt();
+            }
+            if (json.isMember("fadeMs")) {
+                fadeMs = json["fadeMs"].asInt();
+            }
+            if (json.isMember("minTileSize")) {
+                minTileSize = json["minTileSize"].asInt();
+            }
+            return true;
+        }
+
+        void validate() {
+            columns = ofClamp(columns, 1, MAX_SIDE);
+            rows = ofClamp(rows, 1, MAX_SIDE);
+            changes = ofClamp(changes, 0, columns * rows);
+            fadeMs = MAX(1, fadeMs);
+            minTileSize = MAX(1, minTileSize);
+        }
+    };
+
+    enum {
+        MAX_SIDE = 1024
+    };
+
+    // cell i starts on drawing i
+    void setup(const Settings& settings) {
+        _settings = settings;
+        _settings.validate();
+        int n = getNumCells();
+        _drawings.resize(n);
+        _permutation.resize(n);
+        for (int i = 0; i < n; i++) {
+            _drawings[i] = i;
+            _permutation[i] = i;
+        }
+        _fadeStart.assign(n, 0);
+        _activeSlot.assign(n, -1);
+        _active.clear();
+        _active.reserve(n);
+        _sample.reserve(n);
+    }
+
+    const Settings& getSettings() const {
+        return _settings;
+    }
+
+    int getNumCells() const {
+        return _settings.columns * _settings.rows;
+    }
+
+    // n distinct random cells, valid until the next call
+    const vector<int>& sample(int n) {
+        int cells = _permutation.size();
+        n = ofClamp(n, 0, cells);
+        _sample.clear();
+        for (int i = 0; i < n; i++) {
+            int j = i + static_cast<int>(ofRandom(cells - i)) % (cells - i);
+            swap(_permutation[i], _permutation[j]);
+            _sample.push_back(_permutation[i]);
+        }
+        return _sample;
+    }
+
+    // shows drawing in cell and restarts its fade
+    void flash(int cell, int drawing, uint64_t now) {
+        _drawings[cell] = drawing;
+        _fadeStart[cell] = now;
+        if (_activeSlot[cell] < 0) {
+            _activeSlot[cell] = _active.size();
+            _active.push_back(cell);
+        }
+    }
+
+    // drops the cells whose fade is over
+    void update(uint64_t now) {
+        for (int i = 0; i < _active.size();) {
+            int cell = _active[i];
+            if (getFlash(cell, now) > 0) {
+                i++;
+                continue;
+            }
+            _activeSlot[cell] = -1;
+            _active[i] = _active.back();
+            _active.pop_back();
+            if (i < _active.size()) {
+                _activeSlot[_active[i]] = i;
+            }
+        }
+    }
+
+    int getNumActive() const {
+        return _active.size();
+    }
+
+    // 1 right after flash(), 0 once faded
+    float getFlash(int cell, uint64_t now) const {
+        if (_activeSlot[cell] < 0) {
+            return 0;
+        }
+        return MAX(0.0f, 1.0f - static_cast<float>(now - _fadeStart[cell]) / _settings.fadeMs);
+    }
+
+    // side of a tile for a window width
+    float getTileSize(float width) const {
+        return MAX(width * 1.1 / _settings.columns, _settings.minTileSize * width / 1280.0);
+    }
+
+    // The cells overlapping visible, in the grid's own coordinates. Idle cells
+    // are the background colour, so only flashing cells add a rectangle.
+    void draw(TileRenderer& tiles, float width, const ofRectangle& visible, bool invert, uint64_t now) const {
+        int nDrawings = tiles.size();
+        if (nDrawings == 0) {
+            return;
+        }
+        float size = getTileSize(width);
+        // cell j starts at size * j + size / 8
+        int firstColumn = MAX(0, static_cast<int>(floor(visible.getLeft() / size)));
+        int lastColumn = MIN(_settings.columns - 1, static_cast<int>(floor(visible.getRight() / size)));
+        int firstRow = MAX(0, static_cast<int>(floor((visible.getTop() - size / 8) / size)));
+        int lastRow = MIN(_settings.rows - 1, static_cast<int>(floor((visible.getBottom() - size / 8) / size)));
+        for (int j = firstRow; j <= lastRow; j++) {
+            for (int i = firstColumn; i <= lastColumn; i++) {
+                int cell = i + j * _settings.columns;
+                // a cell keeps its drawing across modes, whose corpora can be smaller
+                int drawing = _drawings[cell] % nDrawings;
+                float x = size * i;
+                float y = size * j + size / 8;
+                float v = getFlash(cell, now) * 255;
+                if (v > 0) {
+                    tiles.addTile(drawing, x, y, size, invert ? 255 - v : v, invert ? v : 255 - v);
+                } else {
+                    tiles.addDrawing(drawing, x, y, size, invert ? 0 : 255);
+                }
+            }
+        }
+    }
+
+private:
+    Settings _settings;
+    vector<int> _drawings;
+    vector<int> _permutation;   // sample() shuffles its front
+    vector<int> _sample;
+    vector<uint64_t> _fadeStart;
+    vector<int> _activeSlot;    // position in _active, -1 when idle
+    vector<int> _active;
+};
@@ -0,0 +1,301 @@
+#pragma once
+
+#include "ofMain.h"
+#include "SketchCorpus.h"
+
+// Draws a whole grid of sketch tiles in a couple of draw calls.
+//
+// Every drawing of a corpus is flattened once into GL_LINES segments in a
+// single vertex buffer, addressed by per-drawing offset and count. With the
+// programmable renderer each tile is one instance: the vertex shader fetches
+// its segments from the shared buffer through a buffer texture, and the
+// per-tile transform and stroke grey come in as instance attributes.
+//
+// The GL 2.1 context the app opens for ofxPostProcessing has no instancing,
+// so there the tiles are baked: each tile keeps a range of a second buffer
+// holding its segments already moved, scaled and coloured, and the whole
+// grid is one glMultiDrawArrays over those ranges. A range is only rewritten
+// when its tile changes drawing, place or colour, so a frame where a few
+// tiles flash uploads a few tiles. A tile that needs a longer range than it
+// had gets one at the end of the buffer, and the buffer is packed again once
+// that runs out.
+class TileRenderer {
+public:
+    void setup(SketchCorpus& corpus) {
+        vector<float> segments;
+        _offsets.assign(corpus.size(), 0);
+        _counts.assign(corpus.size(), 0);
+        _maxCount = 0;
+
+        for (int i = 0; i < corpus.size(); i++) {
+            _offsets[i] = segments.size() / 2;
+            int first = corpus.getFirstStroke(i);
+            int last = first + corpus.getNumStrokes(i);
+            for (int s = first; s < last; s++) {
+                const int16_t* v = corpus.getVertices(s);
+                int n = corpus.getNumVertices(s);
+                for (int j = 1; j < n; j++) {
+                    segments.push_back(v[j * 2 - 2]);
+                    segments.push_back(v[j * 2 - 1]);
+                    segments.push_back(v[j * 2]);
+                    segments.push_back(v[j * 2 + 1]);
+                }
+            }
+            _counts[i] = segments.size() / 2 - _offsets[i];
+            _maxCount = MAX(_maxCount, _counts[i]);
+        }
+
+        _segments.setVertexData(segments.data(), 2, segments.size() / 2, GL_STATIC_DRAW);
+
+        _instanced = ofIsGLProgrammableRenderer() && setupShader();
+        if (_instanced) {
+            _segmentTexture.allocateAsBufferTexture(_segments.getVertexBuffer(), GL_RG32F);
+
+            // per-vertex data of an instance is just the vertex number inside the drawing
+            vector<float> ids;
+            for (int i = 0; i < _maxCount; i++) {
+                ids.push_back(i);
+                ids.push_back(0);
+            }
+            _instances.setVertexData(ids.data(), 2, _maxCount, GL_STATIC_DRAW);
+        }
+        _rects.setMode(OF_PRIMITIVE_TRIANGLES);
+        _rects.setUsage(GL_DYNAMIC_DRAW);
+
+        if (!_instanced) {
+            _source.swap(segments);
+            _baked.clear();
+            _bakedUsed = 0;
+            _bakedCapacity = 0;
+        }
+    }
+
+    void begin() {
+        _tiles.clear();
+        _ranges.clear();
+        _rects.clear();
+    }
+
+    int size() const {
+        return _offsets.size();
+    }
+
+    // cell at (x, y, size, size) with the drawing a quarter size inside it
+    void addTile(int drawing, float x, float y, float size, float background, float stroke) {
+        addDrawing(drawing, x, y, size, stroke);
+
+        ofFloatColor c(background / 255.0, 1.0);
+        ofVec3f corners[4] = {ofVec3f(x, y), ofVec3f(x + size, y), ofVec3f(x + size, y + size), ofVec3f(x, y + size)};
+        int order[6] = {0, 1, 2, 0, 2, 3};
+        for (int i = 0; i < 6; i++) {
+            _rects.addVertex(corners[order[i]]);
+            _rects.addColor(c);
+        }
+    }
+
+    // the drawing of a cell without its background, for cells the colour of what is behind them
+    void addDrawing(int drawing, float x, float y, float size, float stroke) {
+        float scale = size / 512.0;
+        _tiles.push_back(x + size * 0.25);
+        _tiles.push_back(y + size * 0.25);
+        _tiles.push_back(scale);
+        _tiles.push_back(stroke / 255.0);
+        _ranges.push_back(_offsets[drawing]);
+        _ranges.push_back(_counts[drawing]);
+    }
+
+    void end() {
+        ofSetColor(255);
+        _rects.draw();
+
+        int n = _tiles.size() / 4;
+        if (n == 0) {
+            return;
+        }
+        if (_instanced) {
+            if (n > _capacity) {
+                _capacity = n;
+                _instances.setAttributeData(TILE_ATTRIBUTE, _tiles.data(), 4, n, GL_STREAM_DRAW);
+                _instances.setAttributeData(RANGE_ATTRIBUTE, _ranges.data(), 2, n, GL_STREAM_DRAW);
+                _instances.setAttributeDivisor(TILE_ATTRIBUTE, 1);
+                _instances.setAttributeDivisor(RANGE_ATTRIBUTE, 1);
+            } else {
+                _instances.updateAttributeData(TILE_ATTRIBUTE, _tiles.data(), n);
+                _instances.updateAttributeData(RANGE_ATTRIBUTE, _ranges.data(), n);
+            }
+            _shader.begin();
+            _shader.setUniformTexture("segments", _segmentTexture, 0);
+            _instances.drawInstanced(GL_LINES, 0, _maxCount, n);
+            _shader.end();
+        } else {
+            drawBaked(n);
+        }
+    }
+
+private:
+    enum {
+        TILE_ATTRIBUTE = 4,
+        RANGE_ATTRIBUTE = 5
+    };
+
+    // where a tile's segments are in the baked buffer, and what they were baked from
+    struct Baked {
+        float tile[4] = {0, 0, 0, -1};
+        int offset = -1;
+        int count = 0;
+        int first = 0;
+        int capacity = 0;
+    };
+
+    void drawBaked(int n) {
+        _baked.resize(n);
+        _firsts.resize(n);
+        _drawCounts.resize(n);
+        _dirty.clear();
+        bool packed = false;
+        for (int i = 0; i < n; i++) {
+            Baked& b = _baked[i];
+            const float* t = &_tiles[i * 4];
+            int offset = _ranges[i * 2];
+            int count = _ranges[i * 2 + 1];
+            bool moved = (b.offset != offset || b.tile[0] != t[0] || b.tile[1] != t[1] || b.tile[2] != t[2]);
+            bool recoloured = (b.tile[3] != t[3]);
+            if (moved && count > b.capacity) {
+                if (_bakedUsed + count > _bakedCapacity) {
+                    packed = true;
+                }
+                b.first = _bakedUsed;
+                b.capacity = count;
+                _bakedUsed += count;
+            }
+            if (!packed && (moved || recoloured)) {
+                bake(b, t, offset, count, moved);
+                _dirty.push_back(i);
+            }
+            _firsts[i] = b.first;
+            _drawCounts[i] = count;
+        }
+
+        if (packed) {
+            pack(n);
+        } else {
+            upload();
+        }
+
+        ofSetColor(255);
+        _bakedVbo.bind();
+        glMultiDrawArrays(GL_LINES, _firsts.data(), _drawCounts.data(), n);
+        _bakedVbo.unbind();
+    }
+
+    // writes tile t's segments, moved and scaled when they moved, into its range
+    void bake(Baked& b, const float* t, int offset, int count, bool moved) {
+        if (moved) {
+            const float* src = &_source[offset * 2];
+            for (int j = 0; j < count; j++) {
+                _bakedVertices[b.first + j].set(t[0] + src[j * 2] * t[2], t[1] + src[j * 2 + 1] * t[2]);
+            }
+        }
+        fill(_bakedColors.begin() + b.first, _bakedColors.begin() + b.first + count, ofFloatColor(t[3], 1.0));
+        memcpy(b.tile, t, sizeof(b.tile));
+        b.offset = offset;
+        b.count = count;
+    }
+
+    // the ranges of the tiles baked this frame, neighbours in one upload
+    void upload() {
+        sort(_dirty.begin(), _dirty.end(), [this](int a, int b) { return _baked[a].first < _baked[b].first; });
+        for (int i = 0; i < _dirty.size();) {
+            int from = _baked[_dirty[i]].first;
+            int to = from + _baked[_dirty[i]].count;
+            for (i++; i < _dirty.size() && _baked[_dirty[i]].first <= to; i++) {
+                to = MAX(to, _baked[_dirty[i]].first + _baked[_dirty[i]].count);
+            }
+            if (to > from) {
+                _bakedVbo.getVertexBuffer().updateData(sizeof(ofVec2f) * from, sizeof(ofVec2f) * (to - from), &_bakedVertices[from]);
+                _bakedVbo.getColorBuffer().updateData(sizeof(ofFloatColor) * from, sizeof(ofFloatColor) * (to - from), &_bakedColors[from]);
+            }
+        }
+    }
+
+    // lays the tiles out again end to end, with room to grow, and uploads everything
+    void pack(int n) {
+        _bakedUsed = 0;
+        for (int i = 0; i < n; i++) {
+            _baked[i].first = _bakedUsed;
+            _baked[i].capacity = _ranges[i * 2 + 1];
+            _bakedUsed += _baked[i].capacity;
+        }
+        _bakedCapacity = MAX(_bakedUsed * 2, MAX(_maxCount, 1));
+        _bakedVertices.resize(_bakedCapacity);
+        _bakedColors.resize(_bakedCapacity);
+        for (int i = 0; i < n; i++) {
+            bake(_baked[i], &_tiles[i * 4], _ranges[i * 2], _ranges[i * 2 + 1], true);
+            _firsts[i] = _baked[i].first;
+        }
+        _bakedVbo.setVertexData(&_bakedVertices[0], _bakedCapacity, GL_DYNAMIC_DRAW);
+        _bakedVbo.setColorData(&_bakedColors[0], _bakedCapacity, GL_DYNAMIC_DRAW);
+    }
+
+    bool setupShader() {
+        string vertex = R"(#version 150
+            uniform mat4 modelViewProjectionMatrix;
+            uniform samplerBuffer segments;
+            in vec4 position;   // x: vertex number
+            in vec4 tile;       // x, y, scale, stroke grey
+            in vec2 range;      // first vertex, vertex count
+            out vec4 colorVarying;
+
+            void main() {
+                if (position.x >= range.y) {
+                    // past the end of this drawing, push it outside the clip volume
+                    gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+                    colorVarying = vec4(0.0);
+                    return;
+                }
+                vec2 p = texelFetch(segments, int(range.x + position.x)).xy;
+                gl_Position = modelViewProjectionMatrix * vec4(tile.xy + p * tile.z, 0.0, 1.0);
+                colorVarying = vec4(vec3(tile.w), 1.0);
+            }
+        )";
+        string fragment = R"(#version 150
+            in vec4 colorVarying;
+            out vec4 outputColor;
+
+            void main() {
+                outputColor = colorVarying;
+            }
+        )";
+        _shader.setupShaderFromSource(GL_VERTEX_SHADER, vertex);
+        _shader.setupShaderFromSource(GL_FRAGMENT_SHADER, fragment);
+        _shader.bindDefaults();
+        _shader.bindAttribute(TILE_ATTRIBUTE, "tile");
+        _shader.bindAttribute(RANGE_ATTRIBUTE, "range");
+        return _shader.linkProgram();
+    }
+
+    vector<int> _offsets, _counts;
+    int _maxCount = 0;
+    bool _instanced = false;
+    int _capacity = 0;
+
+    ofVbo _segments;
+    ofTexture _segmentTexture;
+    ofShader _shader;
+
+    vector<float> _tiles, _ranges;
+    ofVbo _instances;
+    ofVboMesh _rects;
+
+    // without instancing
+    vector<float> _source;          // the segments of every drawing, as in _segments
+    vector<Baked> _baked;           // per tile of the last frame
+    vector<ofVec2f> _bakedVertices;
+    vector<ofFloatColor> _bakedColors;
+    int _bakedUsed = 0;
+    int _bakedCapacity = 0;
+    ofVbo _bakedVbo;
+    vector<GLint> _firsts;
+    vector<GLsizei> _drawCounts;
+    vector<int> _dirty;
+};
@@ -1,49 +1,34 @@
 #pragma once
 
 #include "ofMain.h"
+#include "Kernels.h"
 
 #define SMOOTH_FACTOR 0.86
 
 class Util {
 public:
+    // scales into -1..1, NaN and silence come out as 0
     static void normalize(vector<float>& data) {
-        float maxValue = 0;
-        for(int i = 0; i < data.size(); i++) {
-            if(abs(data[i]) > maxValue) {
-                maxValue = abs(data[i]);
-            }
-        }
-        for(int i = 0; i < data.size(); i++) {
-            data[i] /= maxValue;
-        }
+        Kernels::normalize(data.data(), data.size());
     }
     
-    static float calcVolume(vector<float>& audio) {
-        float curVol = 0.0;
-        //lets go through each sample and calculate the root mean square which is a rough way to calculate volume
-        for (int i = 0; i < audio.size(); i++){
-            float val = audio[i];
-            curVol += val * val;
-        }
-        
-        //this is how we get the mean of rms :)
-        curVol /= (float)audio.size();
-        
-        // this is how we get the root of rms :)
-        curVol = sqrt(curVol);
-        return curVol;
+    // root mean square, a rough way to calculate volume
+    static float calcVolume(const vector<float>& audio) {
+        return Kernels::rms(audio.data(), audio.size());
     }
     
     static float getVolumeMax() {
-        return volumeMax;
+        return volumeMax().load();
     }
     
     static void setVolumeMax(float v) {
-        volumeMax = MIN(1.0, MAX(0.0, v));
-        cout << "Volume Max = " << volumeMax << endl;
+        volumeMax() = MIN(1.0, MAX(0.0, v));
+        cout << "Volume Max = " << volumeMax().load() << endl;
     }
 private:
-    static float volumeMax;
+    // read by the analysis thread, and this header is included from more than one .cpp
+    static atomic<float>& volumeMax() {
+        static atomic<float> v(0.10);
+        return v;
+    }
 };
-
-float Util::volumeMax = 0.10;
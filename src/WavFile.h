@@ -0,0 +1,115 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Reads a whole WAV file into memory as mono float samples.
+//
+// Handles PCM at 8, 16, 24 and 32 bits and 32-bit float, plain or in a
+// WAVE_FORMAT_EXTENSIBLE header. Channels are averaged, as SampleRing does
+// with live input.
+class WavFile {
+public:
+    bool load(string filename) {
+        _samples.clear();
+        _sampleRate = 0;
+        ifstream in(ofToDataPath(filename, true).c_str(), ios::binary);
+        char riff[12];
+        if (!in.read(riff, 12) || memcmp(riff, "RIFF", 4) != 0 || memcmp(riff + 8, "WAVE", 4) != 0) {
+            ofLogError("WavFile") << filename << " is not a RIFF WAVE file";
+            return false;
+        }
+
+        int format = 0, channels = 0, bits = 0;
+        while (in) {
+            char id[4];
+            uint32_t size = 0;
+            if (!in.read(id, 4) || !in.read(reinterpret_cast<char*>(&size), 4)) {
+                break;
+            }
+            if (memcmp(id, "fmt ", 4) == 0 && size >= 16) {
+                vector<char> fmt(size);
+                in.read(fmt.data(), size);
+                format = readInt(fmt.data(), 2);
+                channels = readInt(fmt.data() + 2, 2);
+                _sampleRate = readInt(fmt.data() + 4, 4);
+                bits = readInt(fmt.data() + 14, 2);
+                if (format == 0xfffe && size >= 26) {
+                    // the sub-format GUID starts with the plain format code
+                    format = readInt(fmt.data() + 24, 2);
+                }
+            } else if (memcmp(id, "data", 4) == 0) {
+                if (channels <= 0 || !isSupported(format, bits)) {
+                    ofLogError("WavFile") << filename << ": unsupported format " << format << ", " << bits << " bits";
+                    return false;
+                }
+                vector<char> data(size);
+                in.read(data.data(), size);
+                data.resize(in.gcount());
+                decode(data, format, channels, bits);
+                return true;
+            } else {
+                // chunks are padded to an even size
+                in.seekg(size + (size & 1), ios::cur);
+            }
+        }
+        ofLogError("WavFile") << filename << " has no data chunk";
+        return false;
+    }
+
+    const vector<float>& getSamples() const {
+        return _samples;
+    }
+
+    int getSampleRate() const {
+        return _sampleRate;
+    }
+
+    float getDuration() const {
+        return (_sampleRate > 0 ? static_cast<float>(_samples.size()) / _sampleRate : 0);
+    }
+
+private:
+    static int readInt(const char* p, int bytes) {
+        uint32_t v = 0;
+        for (int i = 0; i < bytes; i++) {
+            v |= static_cast<uint32_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+        }
+        return v;
+    }
+
+    static bool isSupported(int format, int bits) {
+        return (format == 1 && (bits == 8 || bits == 16 || bits == 24 || bits == 32)) || (format == 3 && bits == 32);
+    }
+
+    void decode(const vector<char>& data, int format, int channels, int bits) {
+        int bytes = bits / 8;
+        int frames = data.size() / (bytes * channels);
+        _samples.assign(frames, 0);
+        for (int i = 0; i < frames; i++) {
+            float sum = 0;
+            for (int c = 0; c < channels; c++) {
+                const char* p = data.data() + (i * channels + c) * bytes;
+                sum += decodeSample(p, format, bits);
+            }
+            _samples[i] = sum / channels;
+        }
+    }
+
+    static float decodeSample(const char* p, int format, int bits) {
+        if (format == 3) {
+            float v;
+            memcpy(&v, p, 4);
+            return (v == v ? v : 0);
+        }
+        if (bits == 8) {
+            // 8-bit PCM is the one unsigned format
+            return (static_cast<uint8_t>(p[0]) - 128) / 128.0f;
+        }
+        // sign-extend from the top byte
+        int32_t v = static_cast<int32_t>(static_cast<uint32_t>(readInt(p, bits / 8)) << (32 - bits));
+        return v / 2147483648.0f;
+    }
+
+    vector<float> _samples;
+    int _sampleRate = 0;
+};
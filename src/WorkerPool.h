@@ -0,0 +1,75 @@
+#pragma once
+
+#include "ofMain.h"
+#include <future>
+
+// Small fixed-size thread pool for CPU work that must stay off the render thread.
+class WorkerPool {
+public:
+    explicit WorkerPool(int nThreads = 0) {
+        if (nThreads <= 0) {
+            nThreads = MAX(1, static_cast<int>(thread::hardware_concurrency()) - 1);
+        }
+        _running = true;
+        for (int i = 0; i < nThreads; i++) {
+            _threads.push_back(thread(&WorkerPool::run, this));
+        }
+    }
+
+    ~WorkerPool() {
+        {
+            lock_guard<mutex> lock(_mutex);
+            _running = false;
+        }
+        _cond.notify_all();
+        for (int i = 0; i < _threads.size(); i++) {
+            _threads[i].join();
+        }
+    }
+
+    template<class F>
+    auto submit(F f) -> future<decltype(f())> {
+        typedef decltype(f()) R;
+        shared_ptr<packaged_task<R()> > task(new packaged_task<R()>(f));
+        future<R> result = task->get_future();
+        {
+            lock_guard<mutex> lock(_mutex);
+            _jobs.push_back([task]() { (*task)(); });
+        }
+        _cond.notify_one();
+        return result;
+    }
+
+    int size() const {
+        return _threads.size();
+    }
+
+    // shared by everything that does not need its own workers
+    static WorkerPool& shared() {
+        static WorkerPool pool;
+        return pool;
+    }
+
+private:
+    void run() {
+        while (true) {
+            function<void()> job;
+            {
+                unique_lock<mutex> lock(_mutex);
+                _cond.wait(lock, [this]() { return !_running || !_jobs.empty(); });
+                if (!_running && _jobs.empty()) {
+                    return;
+                }
+                job = move(_jobs.front());
+                _jobs.pop_front();
+            }
+            job();
+        }
+    }
+
+    vector<thread> _threads;
+    deque<function<void()> > _jobs;
+    mutex _mutex;
+    condition_variable _cond;
+    bool _running;
+};
@@ -1,8 +1,100 @@
 #include "ofMain.h"
 #include "ofApp.h"
+#include "SketchIngest.h"
+#include "Benchmark.h"
+
+// mophV --build-corpus [--max N] file.ndjson ...
+static int buildCorpus(int argc, char* argv[]) {
+    int maxSamples = 10000;
+    int failed = 0;
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--max" && i + 1 < argc) {
+            maxSamples = ofToInt(argv[++i]);
+            continue;
+        }
+        string target = SketchCorpus::corpusPathFor(arg);
+        if (SketchIngest::convert(arg, target, maxSamples)) {
+            cout << arg << " -> " << target << endl;
+        } else {
+            cerr << "failed to convert " << arg << endl;
+            failed++;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
+
+// mophV --render file.wav [--state NAME] [--mode N] [--size WxH] [--fps N] [--out DIR|-]
+static int renderOffline(int argc, char* argv[]) {
+    OfflineRender::Settings settings;
+    if (!settings.parse(argc, argv)) {
+        return 1;
+    }
+    if (settings.isRaw()) {
+        // stdout carries the frames
+        ofLogToFile("render.log");
+    }
+    // a hidden window at the output size, for the GL context and for ofGetWidth() in the states
+    ofGLFWWindowSettings window;
+    window.setGLVersion(2, 1);
+    window.width = settings.width;
+    window.height = settings.height;
+    window.visible = false;
+    ofCreateWindow(window);
+
+    ofApp* app = new ofApp();
+    app->setRender(settings);
+    return ofRunApp(app);
+}
+
+// mophV --replay file.mrec [--reanalyze]
+static int replay(int argc, char* argv[]) {
+    Replay::Settings settings;
+    if (!settings.parse(argc, argv)) {
+        return 1;
+    }
+    // resized to the recorded window in setup
+    ofSetupOpenGL(1280, 800, OF_WINDOW);
+    ofApp* app = new ofApp();
+    app->setReplay(settings);
+    return ofRunApp(app);
+}
+
+// mophV --lead host:port [host:port ...] | --follow [--port N] [--delay MS]
+static int linkNodes(int argc, char* argv[]) {
+    AnalysisLink::Settings settings;
+    if (!settings.parse(argc, argv)) {
+        return 1;
+    }
+    ofSetupOpenGL(1280, 800, OF_WINDOW);
+    ofApp* app = new ofApp();
+    app->setLink(settings);
+    return ofRunApp(app);
+}
 
 //========================================================================
-int main( ){
+int main(int argc, char* argv[]){
+    if (argc > 1 && string(argv[1]) == "--build-corpus") {
+        return buildCorpus(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--bench") {
+        return Benchmark::run(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--render") {
+        return renderOffline(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--replay") {
+        return replay(argc, argv);
+    }
+    if (argc > 1 && (string(argv[1]) == "--lead" || string(argv[1]) == "--follow")) {
+        return linkNodes(argc, argv);
+    }
+    if (argc > 1 && string(argv[1]) == "--profile") {
+        // from the start, so setup and loading are in the trace too
+        PhaseTimer::setEnabled(true);
+        PhaseTimer::setTracing(true);
+    }
+
 	ofSetupOpenGL(1280,800,OF_WINDOW);			// <-------- setup the GL context
 
 	// this kicks off the running of my app
@@ -2,52 +2,241 @@
 #include "ShapeState.h"
 #include "SketchState.h"
 
+// keys that change this node only: the window, the profiler, recordings, post resolution
+static bool isNodeKey(int key) {
+    return key == 'f' || key == 'p' || key == 'e' || key == 's' || key == 'r';
+}
+
+// keys that change the analysis, which followers take from the leader's frames
+static bool isAnalysisKey(int key) {
+    return key == '+' || key == '-' || key == '[' || key == ']' || key == 'l';
+}
+
 //--------------------------------------------------------------
 void ofApp::setup(){   
-    ofxEasyFft& fft = _stateMachine.getSharedData();
-    fft.setup(16384);
-    fft.setUseNormalization(false);
+    AudioAnalyzer& analyzer = _stateMachine.getSharedData().analyzer;
+    AnalysisConfig config;
+    config.load("analysis.json");
+    if (_replay.isEnabled()) {
+        if (!_replay.setup(analyzer)) {
+            // the first update exits
+            return;
+        }
+    } else if (_link.isFollowing()) {
+        // no input, the frames come from the leader
+        _recorder.setup(config, 30, 50);
+        _link.setup(analyzer, config);
+    } else if (!_render.isEnabled()) {
+        // the last 30 seconds, saved by itself after a frame over 50 ms
+        _recorder.setup(config, 30, 50);
+        analyzer.setRecorder(&_recorder);
+        analyzer.setup(config);
+        _link.setup(analyzer, config);
+    } else if (!_render.setup(analyzer, config)) {
+        // the first update exits
+        return;
+    }
+    _stateMachine.getSharedData().post.setup(ofGetWidth(), ofGetHeight());
     
-    _stateMachine.addState<ShapeState>();
-    _stateMachine.addState<SketchState>();
+    // states run through _transition, so two of them can draw during a crossfade
+    _stateMachine.disableAppEvents();
+    _stateMachine.disableKeyEvents();
+    _transition.setup(_stateMachine, 1.5);
+    // CircleSingle, CircleMulti, Polygon, Typography
+    _transition.add(_stateMachine.addState<ShapeState>(), 4);
+    // Cats, Dogs, Smiles
+    _transition.add(_stateMachine.addState<SketchState>(), 3);
+    _transition.warmUp();
 
     _states.push_back("Shapes");
     _states.push_back("Sketches");
     
     _stateIndex = 0;
-    _stateMachine.changeState(_states[_stateIndex]);
+    if (_replay.isEnabled()) {
+        // the keys from before the recording bring back its state and mode
+        _transition.start(_states[_stateIndex]);
+        _replay.takeEarlierEvents(_replayEvents);
+        applyEvents(_replayEvents);
+        return;
+    }
+    if (!_render.isEnabled()) {
+        _transition.start(_states[_stateIndex]);
+        return;
+    }
+    const OfflineRender::Settings& settings = _render.getSettings();
+    _transition.start(settings.state);
+    StateTransition::StatePtr state = _transition.getState(settings.state);
+    if (!state) {
+        ofLogError("ofApp") << "no state named " << settings.state;
+        ofExit(1);
+        return;
+    }
+    for (int i = 0; i < settings.mode; i++) {
+        state->keyPressed(OF_KEY_RIGHT);
+    }
+}
+
+//--------------------------------------------------------------
+void ofApp::setRender(const OfflineRender::Settings& settings){
+    _render.setSettings(settings);
+}
+
+//--------------------------------------------------------------
+void ofApp::setReplay(const Replay::Settings& settings){
+    _replay.setSettings(settings);
+}
+
+//--------------------------------------------------------------
+void ofApp::setLink(const AnalysisLink::Settings& settings){
+    _link.setSettings(settings);
+}
+
+//--------------------------------------------------------------
+void ofApp::applyEvents(const vector<Recorder::Event>& events){
+    for (int i = 0; i < events.size(); i++) {
+        const Recorder::Event& e = events[i];
+        if (e.type == Recorder::Key) {
+            handleKey(e.value);
+        } else if (e.type == Recorder::State && e.value != _stateIndex) {
+            ofLogWarning("ofApp") << "replay is in state " << _states[_stateIndex] << ", the recording was in "
+                                  << (e.value < _states.size() ? _states[e.value] : ofToString(e.value));
+        }
+    }
 }
 
 //--------------------------------------------------------------
 void ofApp::update(){
-    ofxEasyFft& fft = _stateMachine.getSharedData();
-    fft.update();
+    if (_render.isEnabled() && !_render.advance()) {
+        return;
+    }
+    if (_replay.isEnabled()) {
+        if (!_replay.advance(_replayEvents)) {
+            return;
+        }
+        applyEvents(_replayEvents);
+        if (_replay.getRecordedFrameMs() > 50) {
+            ofLogNotice("ofApp") << "this frame took " << _replay.getRecordedFrameMs() << " ms live";
+        }
+    } else {
+        if (_link.isFollowing() && _link.advance(_linkEvents)) {
+            followLeader();
+        }
+        AudioAnalyzer::Frame frame = _stateMachine.getSharedData().analyzer.getFrame();
+        _recorder.addFrame(Clock::getElapsedTimef(), ofGetLastFrameTime() * 1000.0, frame ? &*frame : NULL);
+        if (_link.isLeading()) {
+            _link.send(Clock::getElapsedTimef(), _stateIndex, frame ? &*frame : NULL);
+        }
+    }
+    _transition.update();
 }
 
 //--------------------------------------------------------------
-void ofApp::draw(){
+void ofApp::followLeader(){
+    for (int i = 0; i < _linkEvents.size(); i++) {
+        _recorder.addKey(_linkEvents[i].value);
+        handleKey(_linkEvents[i].value);
+    }
+    // a follower that joined late has missed the keys that got the leader there
+    int state = _link.getLeaderState();
+    if (state >= 0 && state < _states.size() && state != _stateIndex) {
+        _stateIndex = state;
+        _transition.fadeTo(_states[_stateIndex]);
+        _recorder.addState(_stateIndex);
+    }
+}
 
+//--------------------------------------------------------------
+void ofApp::draw(){
+    if (_render.isEnabled()) {
+        if (_render.begin()) {
+            _transition.draw();
+            _render.end();
+        }
+        return;
+    }
+    GpuTimer::beginFrame();
+    {
+        PhaseTimer::Scope scope(PhaseTimer::Draw);
+        _transition.draw();
+    }
+    GpuTimer::endFrame();
+    _profiler.update(ofGetLastFrameTime() * 1000.0);
+    _profiler.draw(10, 20);
 }
 
 //--------------------------------------------------------------
 void ofApp::keyPressed(int key){
+    if (_replay.isEnabled()) {
+        // the recording has the keys, only the profiler listens
+        if (key == 'p' || key == 'e') {
+            handleKey(key);
+        }
+        return;
+    }
+    if (_link.isFollowing() && !isNodeKey(key)) {
+        // the leader sends the rest
+        return;
+    }
+    _recorder.addKey(key);
+    if (_link.isLeading() && !isNodeKey(key) && !isAnalysisKey(key)) {
+        _link.addKey(key);
+    }
+    handleKey(key);
+}
+
+//--------------------------------------------------------------
+void ofApp::handleKey(int key){
     if (key == 'f') {
         ofToggleFullscreen();
     } else if (key == OF_KEY_DOWN) {
         _stateIndex = (_stateIndex + 1) % _states.size();
-        _stateMachine.changeState(_states[_stateIndex]);
+        _transition.fadeTo(_states[_stateIndex]);
+        _recorder.addState(_stateIndex);
     } else if (key == '+') {
         float v = Util::getVolumeMax();
         Util::setVolumeMax(v + 0.01);
     } else if (key == '-') {
         float v = Util::getVolumeMax();
         Util::setVolumeMax(v - 0.01);
+    } else if (key == 'r') {
+        // full or half resolution post-processing
+        PostChain& post = _stateMachine.getSharedData().post;
+        post.setRenderScale(post.getRenderScale() < 1.0 ? 1.0 : 0.5);
+    } else if (key == 'p') {
+        _profiler.setEnabled(!_profiler.isEnabled());
+    } else if (key == 's') {
+        _recorder.save("recording-" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".mrec", Clock::getElapsedTimef());
+    } else if (key == 'e') {
+        // the last few seconds of scopes, for chrome://tracing or ui.perfetto.dev
+        if (!PhaseTimer::isTracing()) {
+            ofLogNotice("ofApp") << "tracing is off, p turns it on";
+        } else {
+            string path = "trace-" + ofGetTimestampString("%Y%m%d-%H%M%S") + ".json";
+            if (PhaseTimer::saveTrace(path)) {
+                ofLogNotice("ofApp") << "trace saved to " << ofToDataPath(path);
+            }
+        }
+    } else if (key == '[' || key == ']' || key == 'l') {
+        // restarts the analysis with the new settings, keeps the overlap ratio
+        AudioAnalyzer& analyzer = _stateMachine.getSharedData().analyzer;
+        AnalysisConfig config = analyzer.getConfig();
+        if (key == 'l') {
+            config.logBands = !config.logBands;
+        } else {
+            float overlap = 1.0 - static_cast<float>(config.hopSize) / config.fftSize;
+            config.fftSize = (key == ']' ? config.fftSize * 2 : config.fftSize / 2);
+            config.hopSize = config.fftSize * (1.0 - overlap);
+        }
+        analyzer.restart(config);
     }
+    _transition.keyPressed(key);
 }
 
 //--------------------------------------------------------------
 void ofApp::keyReleased(int key){
-
+    if (!_replay.isEnabled() && !_link.isFollowing()) {
+        _transition.keyReleased(key);
+    }
 }
 
 //--------------------------------------------------------------
@@ -82,7 +271,8 @@ void ofApp::mouseExited(int x, int y){
 
 //--------------------------------------------------------------
 void ofApp::windowResized(int w, int h){
-
+    // reallocated on the next frame, once however many resize events arrive
+    _stateMachine.getSharedData().post.resize(w, h);
 }
 
 //--------------------------------------------------------------
@@ -1,7 +1,13 @@
 #pragma once
 
 #include "ofMain.h"
-#include "ofxEasyFft.h"
+#include "SharedData.h"
+#include "StateTransition.h"
+#include "OfflineRender.h"
+#include "ProfilerOverlay.h"
+#include "Recorder.h"
+#include "Replay.h"
+#include "AnalysisLink.h"
 #include "ofxPostProcessing.h"
 
 #include "ofxTween.h"
@@ -28,8 +34,28 @@ public:
     void dragEvent(ofDragInfo dragInfo);
     void gotMessage(ofMessage msg);
 
+    // before ofRunApp, to render a file instead of running live
+    void setRender(const OfflineRender::Settings& settings);
+    // before ofRunApp, to play a recording back
+    void setReplay(const Replay::Settings& settings);
+    // before ofRunApp, to lead or follow other nodes
+    void setLink(const AnalysisLink::Settings& settings);
+
 private:
-    ofxStateMachine<ofxEasyFft> _stateMachine;
+    // everything a key does, live or replayed
+    void handleKey(int key);
+    void applyEvents(const vector<Recorder::Event>& events);
+    void followLeader();
+
+    ofxStateMachine<SharedData> _stateMachine;
+    StateTransition _transition;
+    OfflineRender _render;
+    ProfilerOverlay _profiler;
+    Recorder _recorder;
+    Replay _replay;
+    vector<Recorder::Event> _replayEvents;
+    AnalysisLink _link;
+    vector<Recorder::Event> _linkEvents;
     vector<string> _states;
     int _stateIndex;
 };